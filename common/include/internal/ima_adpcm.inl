@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace hle_audio {
+
+static const int16_t c_ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t c_ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const uint32_t IMA_BLOCK_HEADER_BYTE_SIZE = 4;
+static const uint32_t IMA_MAX_CHANNELS = 8;
+
+struct ima_adpcm_state_t {
+    int32_t predictor;
+    int32_t step_index;
+};
+
+static inline int32_t ima_clamp(int32_t v, int32_t lo, int32_t hi) {
+    return v < lo ? lo : (hi < v ? hi : v);
+}
+
+static inline int16_t ima_decode_nibble(ima_adpcm_state_t* state, uint8_t nibble) {
+    int32_t step = c_ima_step_table[state->step_index];
+
+    int32_t diff = step >> 3;
+    if (nibble & 1) diff += step >> 2;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 4) diff += step;
+    if (nibble & 8) diff = -diff;
+
+    state->predictor = ima_clamp(state->predictor + diff, INT16_MIN, INT16_MAX);
+    state->step_index = ima_clamp(state->step_index + c_ima_index_table[nibble], 0, 88);
+
+    return int16_t(state->predictor);
+}
+
+static inline uint8_t ima_encode_sample(ima_adpcm_state_t* state, int16_t sample) {
+    int32_t step = c_ima_step_table[state->step_index];
+    int32_t diff = sample - state->predictor;
+
+    uint8_t nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    if (step <= diff) { nibble |= 4; diff -= step; }
+    step >>= 1;
+    if (step <= diff) { nibble |= 2; diff -= step; }
+    step >>= 1;
+    if (step <= diff) { nibble |= 1; }
+
+    // keep encoder state in sync with decoder
+    ima_decode_nibble(state, nibble);
+    return nibble;
+}
+
+static inline uint32_t ima_samples_per_channel_block(uint32_t channel_block_size) {
+    return 1 + (channel_block_size - IMA_BLOCK_HEADER_BYTE_SIZE) * 2;
+}
+
+/**
+ * encodes interleaved samples of a block into per channel blocks (planar):
+ *  [int16 predictor | uint8 step index | uint8 reserved | 4 bit samples, low nibble first]
+ * states step index is carried over blocks
+ */
+static inline void ima_encode_block(ima_adpcm_state_t* states, const int16_t* samples,
+        uint32_t channels, uint32_t channel_block_size, uint8_t* out_block) {
+    const uint32_t sample_count = ima_samples_per_channel_block(channel_block_size);
+
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        auto& state = states[ch];
+        auto out_ptr = out_block + ch * channel_block_size;
+
+        int16_t first_sample = samples[ch];
+        state.predictor = first_sample;
+        memcpy(out_ptr, &first_sample, sizeof(first_sample));
+        out_ptr[2] = uint8_t(state.step_index);
+        out_ptr[3] = 0;
+        out_ptr += IMA_BLOCK_HEADER_BYTE_SIZE;
+
+        for (uint32_t i = 1; i < sample_count; i += 2) {
+            uint8_t lo = ima_encode_sample(&state, samples[i * channels + ch]);
+            uint8_t hi = ima_encode_sample(&state, samples[(i + 1) * channels + ch]);
+            *out_ptr++ = uint8_t(lo | (hi << 4));
+        }
+    }
+}
+
+/**
+ * decodes planar block into interleaved samples,
+ * channels are decoded in lockstep, so per channel state updates are independent lanes
+ */
+static inline void ima_decode_block(const uint8_t* block,
+        uint32_t channels, uint32_t channel_block_size, int16_t* out_samples) {
+    ima_adpcm_state_t states[IMA_MAX_CHANNELS];
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        auto ch_block = block + ch * channel_block_size;
+
+        int16_t predictor;
+        memcpy(&predictor, ch_block, sizeof(predictor));
+        states[ch].predictor = predictor;
+        states[ch].step_index = ch_block[2] < 89 ? ch_block[2] : 88;
+
+        out_samples[ch] = predictor;
+    }
+
+    auto out_ptr = out_samples + channels;
+    const uint32_t data_size = channel_block_size - IMA_BLOCK_HEADER_BYTE_SIZE;
+    for (uint32_t i = 0; i < data_size; ++i) {
+        for (uint32_t ch = 0; ch < channels; ++ch) {
+            uint8_t byte = block[ch * channel_block_size + IMA_BLOCK_HEADER_BYTE_SIZE + i];
+            out_ptr[ch] = ima_decode_nibble(&states[ch], byte & 0x0f);
+            out_ptr[channels + ch] = ima_decode_nibble(&states[ch], byte >> 4);
+        }
+        out_ptr += 2 * channels;
+    }
+}
+
+}
@@ -3,6 +3,8 @@
 #include "sparse_vector.h"
 #include "index_id.h"
 #include <string>
+#include <cstdio>
+#include <unordered_map>
 #include "rt_types.h"
 
 namespace hle_audio {
@@ -163,14 +165,63 @@ struct audio_file_data_t {
     rt::file_data_t::meta_t meta;
     std::vector<uint8_t> content;
     rt::range_t data_chunk_range;
+
+    // frames seek table, offsets are relative to data chunk
+    uint32_t samples_per_frame;
+    uint32_t frames_per_seek_entry;
+    std::vector<uint32_t> seek_frame_offsets;
 };
 
 class audio_file_data_provider_ti {
 public:
-    virtual audio_file_data_t get_file_data(const char* filename, uint32_t file_index) = 0;
+    // stream is true for files written to the streaming file
+    virtual audio_file_data_t get_file_data(const char* filename, uint32_t file_index, bool stream) = 0;
+};
+
+/**
+ * @brief write runtime bank blob, streamed files data goes to streaming file
+ * 
+ * @param stream_head_size first bytes of each streamed file also stored in blob, so start doesn't wait for reading,
+ *      flac decoder keeps 32KB of input ahead, so flac head should be larger than that
+ * @param stream_alignment power of 2 up to 64KB (streaming chunk size), streamed files data starts on it
+ *      in streaming file, so runtime reads whole aligned blocks, 0 packs data
+ * @return empty buffer if some group nests counted repeat nodes deeper than rt::MAX_PROGRAM_LOOP_DEPTH
+ */
+std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_file_data_provider_ti* fdata_provider, 
+        const char* streaming_filename = nullptr, uint32_t stream_head_size = 0, uint32_t stream_alignment = 0);
+
+/**
+ * streaming file written by one or several banks, same data is written once,
+ * so banks built together share samples in one streaming file
+ */
+struct stream_file_writer_t {
+    FILE* file;
+    uint32_t alignment;
+
+    // tracked instead of ftell, streaming file could be over 4GB
+    uint64_t offset;
+    // by content hash, bytes are compared with ones read back from file on hash match
+    std::unordered_multimap<uint64_t, rt::stream_range_t> written_data;
+
+    /**
+     * distinct resident data of all banks, its index + 1 is file_data_t::content_id
+     */
+    struct resident_content_t {
+        rt::file_data_t::meta_t meta;
+        std::vector<uint8_t> data;
+    };
+    std::vector<resident_content_t> resident_contents;
+    std::unordered_multimap<uint64_t, uint32_t> resident_content_indices; // by content hash
 };
 
-std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_file_data_provider_ti* fdata_provider, const char* streaming_filename = nullptr);
+bool open(stream_file_writer_t& writer, const char* filename, uint32_t alignment);
+void close(stream_file_writer_t& writer);
+
+/**
+ * @brief write runtime bank blob, streamed files data goes to (shared) streaming file writer
+ */
+std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_file_data_provider_ti* fdata_provider, 
+        stream_file_writer_t& stream_writer, uint32_t stream_head_size = 0);
 
 /**
  * @brief Init data state from Json file
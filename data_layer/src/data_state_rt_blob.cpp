@@ -6,6 +6,7 @@
 #include <cassert>
 #include <cstring>
 #include <algorithm>
+#include <numeric>
 #include "internal/memory_utils.inl"
 
 namespace hle_audio {
@@ -51,6 +52,13 @@ static rt::offset_typed_t<T> write_single(std::vector<uint8_t>& buf, const T& v)
     return write(buf, &v, 1).elements;
 }
 
+// zeroed array, filled in place later
+template<typename T>
+static rt::array_view_t<T> reserve(std::vector<uint8_t>& buf, size_t count) {
+    std::vector<T> values(count);
+    return write(buf, values);
+}
+
 static rt::char_offset_t write(std::vector<uint8_t>& buf, std::string_view str) {
     // this expects c string and copies trailing null as well
     assert(str.data()[str.size()] == '\0');
@@ -68,10 +76,8 @@ static rt::char_offset_t write(std::vector<uint8_t>& buf, std::u8string_view str
 namespace editor {
 
 struct save_context_t {
-    std::vector<rt::file_node_t> nodes_file;
-    std::vector<rt::random_node_t> nodes_random;
-    std::vector<rt::sequence_node_t> nodes_sequence;
-    std::vector<rt::repeat_node_t> nodes_repeat;
+    // programs of all groups, one after another
+    std::vector<rt::program_op_t> program_ops;
     std::vector<rt::file_data_t> file_data;
 
     struct file_data_t {
@@ -80,6 +86,9 @@ struct save_context_t {
     };
     std::vector<file_data_t> sound_file_data;
     std::unordered_map<std::u8string_view, uint32_t> sound_files_indices;
+
+    // repeat nodes nested deeper than runtime loop counters allow
+    bool loop_depth_overflow;
 };
 
 static rt::named_group_t make_named_group(std::vector<uint8_t>& buf, 
@@ -87,48 +96,55 @@ static rt::named_group_t make_named_group(std::vector<uint8_t>& buf,
         float volume,
         float cross_fade_time,
         uint8_t output_bus_index,
-        const rt::node_desc_t& root_node) {
+        const rt::array_view_t<rt::program_op_t>& program) {
 
     rt::named_group_t gr = {};
     gr.name = write(buf, name);
     gr.volume = volume;
     gr.cross_fade_time = cross_fade_time;
     gr.output_bus_index = output_bus_index;
-    gr.node = root_node;
+    gr.program = program;
 
     return gr;
 }
 
 static rt::event_t make_event(std::vector<uint8_t>& buf, 
         std::string_view name,
-        const std::vector<rt::action_t>& actions) {
+        const rt::array_view_t<rt::action_t>& actions) {
     rt::event_t ev = {};
     ev.name = write(buf, name);
-    ev.actions = write(buf, actions);
+    ev.actions = actions;
 
     return ev;
 }
 
-static rt::offset_typed_t<rt::store_t> write_store(std::vector<uint8_t>& buf,
-        const save_context_t& ctx,
-        const std::vector<rt::named_group_t>& groups,
-        const std::vector<rt::event_t>& events) {
+static std::vector<rt::event_index_entry_t> make_event_index(const std::vector<event_t>& events) {
+    if (events.empty()) return {};
 
-    // todo: use char_offset_t instead of indexing into sound_files
+    // at most half full, probing stops on free slot quickly
+    size_t size = 1;
+    while (size < events.size() * 2) size *= 2;
 
-    rt::store_t store = {};
-    store.nodes_file = write(buf, ctx.nodes_file);
-    store.nodes_random = write(buf, ctx.nodes_random);
-    store.nodes_sequence = write(buf, ctx.nodes_sequence);
-    store.nodes_repeat = write(buf, ctx.nodes_repeat);
-    store.groups = write(buf, groups);
-    store.events = write(buf, events);
-    store.file_data = write(buf, ctx.file_data);
-
-    return write_single(buf, store);
+    rt::event_index_entry_t empty_entry = {};
+    empty_entry.event_index = rt::EMPTY_EVENT_INDEX;
+    std::vector<rt::event_index_entry_t> index(size, empty_entry);
+
+    auto mask = size - 1;
+    for (uint32_t i = 0; i < events.size(); ++i) {
+        auto hash = rt::event_name_hash(events[i].name.c_str());
+
+        auto slot = hash & mask;
+        while (index[slot].event_index != rt::EMPTY_EVENT_INDEX) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot].name_hash = hash;
+        index[slot].event_index = i;
+    }
+
+    return index;
 }
 
-static rt::file_node_t cache_file(std::vector<uint8_t>& buf, save_context_t* ctx, const file_node_t& file_node) {
+static uint32_t cache_file(save_context_t* ctx, const file_node_t& file_node) {
     std::u8string_view filename = file_node.filename;
 
     uint32_t index = 0;
@@ -147,86 +163,266 @@ static rt::file_node_t cache_file(std::vector<uint8_t>& buf, save_context_t* ctx
         ctx->sound_file_data.push_back(fdata);
     }
 
-    rt::file_node_t res = {};
-    res.file_index = index;
-    res.loop = file_node.loop;
-    return res;
+    return index;
+}
+
+static rt::program_op_t make_op(rt::program_op_e type, uint32_t arg) {
+    rt::program_op_t op = {};
+    op.type = type;
+    op.arg = arg;
+    return op;
 }
 
-static rt::node_desc_t save_node_rec(std::vector<uint8_t>& buf, save_context_t* ctx, 
-        const data_state_t* state, const node_desc_t& desc) {
+/**
+ * append node ops to group program, jump targets are op indices in group program
+ * 
+ * @return false if node can't produce any sound, nothing is appended then
+ */
+static bool compile_node_rec(save_context_t* ctx, const data_state_t* state, const node_desc_t& desc,
+        uint8_t loop_depth, std::vector<rt::program_op_t>& ops) {
 
     auto index = get_index(state->node_ids, desc.id);
-    uint16_t out_index = 0;
     switch (desc.type)
     {
     case rt::node_type_e::None: {
-        break;
+        return false;
     }
     case rt::node_type_e::File: {
         auto& file_node = state->nodes_file[index];
 
-        out_index = (uint16_t)ctx->nodes_file.size();
-
-        ctx->nodes_file.push_back(cache_file(buf, ctx, file_node));
+        auto op_type = file_node.loop ? rt::program_op_e::play_loop : rt::program_op_e::play;
+        ops.push_back(make_op(op_type, cache_file(ctx, file_node)));
 
-        break;
+        return true;
     }
     case rt::node_type_e::Random: {
         auto& rnd_node = state->nodes_random[index];
 
-        std::vector<rt::node_desc_t> ch_nodes;
-        for (auto& ch_desc : rnd_node.nodes) {
-            ch_nodes.push_back(save_node_rec(buf, ctx, state, ch_desc));
+        auto choice_count = (uint32_t)rnd_node.nodes.size();
+        if (!choice_count) return false;
+
+        // random op skips to one of jumps following it
+        auto random_pos = ops.size();
+        ops.push_back(make_op(rt::program_op_e::random, choice_count));
+        auto table_pos = ops.size();
+        ops.resize(table_pos + choice_count, make_op(rt::program_op_e::jump, 0));
+
+        bool has_play = false;
+        std::vector<size_t> exit_jumps;
+        for (uint32_t i = 0; i < choice_count; ++i) {
+            auto choice_pos = ops.size();
+            if (!compile_node_rec(ctx, state, rnd_node.nodes[i], loop_depth, ops)) {
+                // silent choice goes straight to the end
+                exit_jumps.push_back(table_pos + i);
+                continue;
+            }
+            has_play = true;
+
+            ops[table_pos + i].arg = (uint32_t)choice_pos;
+            // last choice falls through
+            if (i + 1 < choice_count) {
+                exit_jumps.push_back(ops.size());
+                ops.push_back(make_op(rt::program_op_e::jump, 0));
+            }
         }
 
-        out_index = (uint16_t)ctx->nodes_random.size();
+        if (!has_play) {
+            ops.resize(random_pos);
+            return false;
+        }
 
-        rt::random_node_t node = {};
-        node.nodes = write(buf, ch_nodes);
-        ctx->nodes_random.push_back(node);
+        for (auto pos : exit_jumps) {
+            ops[pos].arg = (uint32_t)ops.size();
+        }
 
-        break;
+        return true;
     }
     case rt::node_type_e::Sequence: {
         auto& seq_node = state->nodes_sequence[index];
 
-        std::vector<rt::node_desc_t> ch_nodes;
+        bool has_play = false;
         for (auto& ch_desc : seq_node.nodes) {
-            ch_nodes.push_back(save_node_rec(buf, ctx, state, ch_desc));
+            has_play |= compile_node_rec(ctx, state, ch_desc, loop_depth, ops);
         }
 
-        out_index = (uint16_t)ctx->nodes_sequence.size();
-
-        rt::sequence_node_t node = {};
-        node.nodes = write(buf, ch_nodes);
-        ctx->nodes_sequence.push_back(node);
-
-        break;
+        return has_play;
     }
     case rt::node_type_e::Repeat: {
         auto& rep_node = state->nodes_repeat[index];
 
-        auto ndesc = save_node_rec(buf, ctx, state, rep_node.node);
+        // 0 repeats forever without counter
+        bool counted = 1 < rep_node.repeat_count;
+        if (counted && loop_depth == rt::MAX_PROGRAM_LOOP_DEPTH) {
+            ctx->loop_depth_overflow = true;
+            return false;
+        }
 
-        out_index = (uint16_t)ctx->nodes_repeat.size();
+        auto body_pos = ops.size();
+        if (!compile_node_rec(ctx, state, rep_node.node, uint8_t(loop_depth + counted), ops)) return false;
 
-        rt::repeat_node_t rt_node = {};
-        rt_node.repeat_count = rep_node.repeat_count;
-        rt_node.node = ndesc;
-        ctx->nodes_repeat.push_back(rt_node);
+        if (counted) {
+            auto op = make_op(rt::program_op_e::loop_next, (uint32_t)body_pos);
+            op.slot = loop_depth;
+            op.count = rep_node.repeat_count;
+            ops.push_back(op);
+        } else if (rep_node.repeat_count == 0) {
+            ops.push_back(make_op(rt::program_op_e::jump, (uint32_t)body_pos));
+        }
 
-        break;
+        return true;
     }
     default:
         assert(false);
         break;
     }
 
-    return {desc.type, out_index};
+    return false;
 }
 
-std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_file_data_provider_ti* fdata_provider, const char* streaming_filename) {
+/**
+ * head is cut on block boundary for formats decoded by whole blocks,
+ * and on stream alignment, so reads after the head stay aligned
+ */
+static uint32_t get_stream_head_size(const rt::file_data_t::meta_t& meta, uint32_t data_size, uint32_t max_head_size, uint32_t stream_alignment) {
+    uint32_t block_size = 1;
+    if (meta.coding_format == rt::audio_format_type_e::pcm) {
+        block_size = sizeof(int16_t) * meta.channels;
+    } else if (meta.coding_format == rt::audio_format_type_e::adpcm) {
+        block_size = rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE * meta.channels;
+    }
+    if (stream_alignment) {
+        block_size = std::lcm(block_size, stream_alignment);
+    }
+
+    auto head_size = std::min(data_size, max_head_size);
+    if (head_size < data_size) {
+        head_size -= head_size % block_size;
+    }
+    return head_size;
+}
+
+// fnv-1a, lookup key of written data, its matches are compared by bytes
+static uint64_t content_hash(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool open(stream_file_writer_t& writer, const char* filename, uint32_t alignment) {
+    assert((alignment & (alignment - 1)) == 0 && "alignment should be power of 2");
+
+    writer = {};
+    // read as well, written data is compared on content hash match
+    writer.file = fopen(filename, "w+b");
+    writer.alignment = alignment;
+    return writer.file != nullptr;
+}
+
+void close(stream_file_writer_t& writer) {
+    if (writer.file) {
+        fclose(writer.file);
+        writer.file = nullptr;
+    }
+}
+
+static bool seek_file(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, int64_t(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+static bool is_written_data_equal(stream_file_writer_t& writer, rt::stream_range_t range, const uint8_t* data) {
+    if (!seek_file(writer.file, range.offset)) return false;
+
+    uint8_t read_buf[4096];
+    uint64_t compared = 0;
+    while (compared < range.size) {
+        auto size = size_t(std::min<uint64_t>(range.size - compared, sizeof(read_buf)));
+        if (fread(read_buf, size, 1, writer.file) != 1) return false;
+        if (memcmp(read_buf, data + compared, size) != 0) return false;
+        compared += size;
+    }
+    return true;
+}
+
+/**
+ * append data to streaming file, data written before (by any bank) is referenced instead
+ */
+static rt::stream_range_t write_stream_data(stream_file_writer_t& writer, uint64_t hash, const uint8_t* data, uint32_t size) {
+    auto written_range = writer.written_data.equal_range(hash);
+    for (auto it = written_range.first; it != written_range.second; ++it) {
+        if (it->second.size != size) continue;
+
+        bool equal = is_written_data_equal(writer, it->second, data);
+        // switch back to appending
+        seek_file(writer.file, writer.offset);
+        if (equal) return it->second;
+    }
+
+    // pad previous file data up to aligned start
+    if (writer.alignment) {
+        auto pad_size = (writer.alignment - writer.offset % writer.alignment) % writer.alignment;
+        writer.offset += pad_size;
+        static const uint8_t zeros[4096] = {};
+        while (pad_size) {
+            auto size = std::min<size_t>(pad_size, sizeof(zeros));
+            fwrite(zeros, size, 1, writer.file);
+            pad_size -= size;
+        }
+    }
+
+    auto written = fwrite(data, size, 1, writer.file);
+    assert(written == 1 && "write fully");
+
+    rt::stream_range_t res = {};
+    res.offset = writer.offset;
+    res.size = size;
+    writer.offset += size;
+
+    writer.written_data.emplace(hash, res);
+
+    return res;
+}
+
+static bool is_same_meta(const rt::file_data_t::meta_t& a, const rt::file_data_t::meta_t& b) {
+    return a.coding_format == b.coding_format &&
+        a.loop_start == b.loop_start &&
+        a.loop_end == b.loop_end &&
+        a.length_in_samples == b.length_in_samples &&
+        a.sample_rate == b.sample_rate &&
+        a.channels == b.channels;
+}
+
+/**
+ * @return id of resident data, same for equal data and meta of any bank written with the writer
+ */
+static uint32_t register_resident_content(stream_file_writer_t& writer, uint64_t hash, 
+        const rt::file_data_t::meta_t& meta, const uint8_t* data, uint32_t size) {
+    auto registered_range = writer.resident_content_indices.equal_range(hash);
+    for (auto it = registered_range.first; it != registered_range.second; ++it) {
+        auto& content = writer.resident_contents[it->second];
+        if (content.data.size() == size && is_same_meta(content.meta, meta) &&
+                memcmp(content.data.data(), data, size) == 0) {
+            return it->second + 1;
+        }
+    }
+
+    auto index = uint32_t(writer.resident_contents.size());
+    stream_file_writer_t::resident_content_t content = {};
+    content.meta = meta;
+    content.data.assign(data, data + size);
+    writer.resident_contents.push_back(std::move(content));
+    writer.resident_content_indices.emplace(hash, index);
+
+    return index + 1;
+}
+
+static std::vector<uint8_t> save_store_blob(const data_state_t* state, audio_file_data_provider_ti* fdata_provider, 
+        stream_file_writer_t* stream_writer, uint32_t stream_head_size) {
     std::vector<uint8_t> buf;
 
     rt::root_header_t header = {};
@@ -235,51 +431,88 @@ std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_fil
 
     save_context_t ctx = {};
 
+    // compile group trees
+    std::vector<size_t> program_starts;
+    program_starts.reserve(state->groups.size() + 1);
+    std::vector<rt::program_op_t> group_ops;
+    for (auto& group : state->groups) {
+        group_ops.clear();
+        compile_node_rec(&ctx, state, group.node, 0, group_ops);
+
+        program_starts.push_back(ctx.program_ops.size());
+        ctx.program_ops.insert(ctx.program_ops.end(), group_ops.begin(), group_ops.end());
+    }
+    program_starts.push_back(ctx.program_ops.size());
+
+    // runtime couldn't run some program
+    if (ctx.loop_depth_overflow) return {};
+
+    //
+    // hot section, read on event fire and sound start: store, groups, programs, events and file meta
+    // arrays referencing cold data are reserved here and filled once cold offsets are known
+    //
+    auto store_offset = write_single(buf, rt::store_t{});
+
+    rt::store_t store = {};
+    store.groups = reserve<rt::named_group_t>(buf, state->groups.size());
+
+    // programs are kept together, so playing groups touch one blob region
+    auto program_ops = write(buf, ctx.program_ops);
+
+    store.event_index = write(buf, make_event_index(state->events));
+    store.events = reserve<rt::event_t>(buf, state->events.size());
+
+    std::vector<rt::array_view_t<rt::action_t>> event_actions;
+    event_actions.reserve(state->events.size());
+    for (auto& ev : state->events) {
+        event_actions.push_back(write(buf, ev.actions));
+    }
+
+    if (fdata_provider) {
+        store.file_data = reserve<rt::file_data_t>(buf, ctx.sound_file_data.size());
+    }
+
+    //
+    // cold section: names, seek tables, stream heads, then resident sample data in the blob tail
+    //
+    static const rt::offset_t CACHE_LINE_SIZE = 64;
+    static const rt::offset_t RESIDENT_DATA_ALIGNMENT = 16;
+    buf.resize(align_forward((rt::offset_t)buf.size(), CACHE_LINE_SIZE));
+
     std::vector<rt::named_group_t> groups;
     groups.reserve(state->groups.size());
-    for (auto& group : state->groups) {
-        auto desc = save_node_rec(buf, &ctx, state, group.node);
+    for (size_t i = 0; i < state->groups.size(); ++i) {
+        auto& group = state->groups[i];
+
+        rt::array_view_t<rt::program_op_t> program = {};
+        program.count = uint32_t(program_starts[i + 1] - program_starts[i]);
+        program.elements.pos = program_ops.elements.pos + rt::offset_t(program_starts[i] * sizeof(rt::program_op_t));
 
         auto fbo_group = make_named_group(buf, 
             group.name,
             group.volume,
             group.cross_fade_time,
             group.output_bus_index,
-            desc
+            program
         );
         groups.push_back(fbo_group);
     }
 
     std::vector<rt::event_t> events;
     events.reserve(state->events.size());
-    for (auto& ev : state->events) {
-        events.push_back(make_event(buf, ev .name, ev.actions));
+    for (size_t i = 0; i < state->events.size(); ++i) {
+        events.push_back(make_event(buf, state->events[i].name, event_actions[i]));
     }
 
-    // sort events by name
-    rt::buffer_t buf_view = {};
-    buf_view.ptr = buf.data();
-    std::sort(events.begin(), events.end(), 
-            [&buf_view](const rt::event_t& e1, 
-                    const rt::event_t& e2) {
-        return strcmp(
-                e1.name.get_ptr(buf_view), 
-                e2.name.get_ptr(buf_view)
-            ) < 0;
-    });
-
     if (fdata_provider) {
+        uint32_t stream_alignment = stream_writer ? stream_writer->alignment : 0;
 
-        FILE* streaming_file = nullptr;
-        if (streaming_filename) {
-            streaming_file = fopen(streaming_filename, "wb");
-            // expect valid?
-        }
-
+        // resident data is appended after all other data, offsets are relative till then
+        std::vector<uint8_t> resident_buf;
 
         uint32_t it_index = 0;
         for (auto& sound_file_data : ctx.sound_file_data) {
-            auto fdata = fdata_provider->get_file_data((const char*)sound_file_data.filename.data(), it_index);
+            auto fdata = fdata_provider->get_file_data((const char*)sound_file_data.filename.data(), it_index, sound_file_data.stream);
             auto stream = sound_file_data.stream;
 
             // write only data chunk
@@ -290,36 +523,70 @@ std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_fil
             rt_fd.meta = fdata.meta;
             rt_fd.meta.stream = stream ? 1 : 0;
             if (!stream) { 
-                rt_fd.data_buffer = write(buf, content_data, content_data_size);
-            } else if (streaming_file) {
-                auto start_offset = ftell(streaming_file);
-                auto written = fwrite(content_data, content_data_size, 1, streaming_file);
-                assert(written == 1 && "write fully");
-
-                rt::array_view_t<uint8_t> buf_range = {};
-                buf_range.count = content_data_size;
-                buf_range.elements.pos = start_offset;
-                rt_fd.data_buffer = buf_range;
+                rt_fd.data_buffer = write(resident_buf, content_data, content_data_size);
+                if (stream_writer) {
+                    rt_fd.content_id = register_resident_content(*stream_writer, 
+                        content_hash(content_data, content_data_size), rt_fd.meta, content_data, content_data_size);
+                }
+            } else if (stream_writer) {
+                auto hash = content_hash(content_data, content_data_size);
+                rt_fd.stream_data = write_stream_data(*stream_writer, hash, content_data, content_data_size);
+
+                auto head_size = get_stream_head_size(fdata.meta, content_data_size, stream_head_size, stream_alignment);
+                if (head_size) {
+                    rt_fd.stream_head = write(buf, content_data, head_size);
+                }
+            }
+
+            if (fdata.seek_frame_offsets.size()) {
+                rt_fd.seek_table.samples_per_frame = fdata.samples_per_frame;
+                rt_fd.seek_table.frames_per_entry = fdata.frames_per_seek_entry;
+                rt_fd.seek_table.frame_offsets = write(buf, fdata.seek_frame_offsets);
             }
             ctx.file_data.push_back(rt_fd);
 
             ++it_index;
         }
 
-        if (streaming_file) {
-            fclose(streaming_file);
+        header.resident_data_offset = align_forward((rt::offset_t)buf.size(), RESIDENT_DATA_ALIGNMENT);
+        buf.resize(header.resident_data_offset);
+        buf.insert(buf.end(), resident_buf.begin(), resident_buf.end());
+        for (auto& rt_fd : ctx.file_data) {
+            if (rt_fd.data_buffer.count) rt_fd.data_buffer.elements.pos += header.resident_data_offset;
         }
+    } else {
+        header.resident_data_offset = (rt::offset_t)buf.size();
     }
 
-    auto store_offset = write_store(buf,
-            ctx, groups, events);
+    // fill hot arrays
+    write(buf, store.groups.elements, groups.data(), groups.size());
+    write(buf, store.events.elements, events.data(), events.size());
+    write(buf, store.file_data.elements, ctx.file_data.data(), ctx.file_data.size());
+    write(buf, store_offset, &store, 1);
 
     // write root offset finally
     header.store = store_offset;
+    header.stream_alignment = stream_writer ? stream_writer->alignment : 0;
     write(buf, store_header_offset, &header, 1);
 
     return buf;
 }
 
+std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_file_data_provider_ti* fdata_provider, 
+        const char* streaming_filename, uint32_t stream_head_size, uint32_t stream_alignment) {
+    stream_file_writer_t stream_writer = {};
+    bool has_streaming_file = streaming_filename && open(stream_writer, streaming_filename, stream_alignment);
+
+    auto res = save_store_blob(state, fdata_provider, has_streaming_file ? &stream_writer : nullptr, stream_head_size);
+
+    close(stream_writer);
+    return res;
+}
+
+std::vector<uint8_t> save_store_blob_buffer(const data_state_t* state, audio_file_data_provider_ti* fdata_provider, 
+        stream_file_writer_t& stream_writer, uint32_t stream_head_size) {
+    return save_store_blob(state, fdata_provider, stream_writer.file ? &stream_writer : nullptr, stream_head_size);
+}
+
 }
 }
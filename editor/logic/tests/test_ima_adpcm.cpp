@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "rt_types.h"
+#include "internal/ima_adpcm.inl"
+
+#include <cmath>
+#include <vector>
+
+using namespace hle_audio;
+
+TEST(ima_adpcm, block_round_trip)
+{
+    const uint32_t channels = 2;
+    const uint32_t block_count = 3;
+    const uint32_t frames_per_block = rt::ADPCM_SAMPLES_PER_BLOCK;
+    const uint32_t block_size = rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE * channels;
+
+    ASSERT_EQ(ima_samples_per_channel_block(rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE), frames_per_block);
+
+    // different tone per channel, second channel is quieter
+    std::vector<int16_t> samples(block_count * frames_per_block * channels);
+    for (uint32_t frame = 0; frame < block_count * frames_per_block; ++frame) {
+        samples[frame * channels + 0] = int16_t(12000.0 * sin(frame * 0.05));
+        samples[frame * channels + 1] = int16_t(3000.0 * sin(frame * 0.11));
+    }
+
+    std::vector<uint8_t> encoded(block_count * block_size);
+    ima_adpcm_state_t states[channels] = {};
+    for (uint32_t block = 0; block < block_count; ++block) {
+        ima_encode_block(states, samples.data() + block * frames_per_block * channels,
+            channels, rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE, encoded.data() + block * block_size);
+    }
+
+    std::vector<int16_t> decoded(frames_per_block * channels);
+    for (uint32_t block = 0; block < block_count; ++block) {
+        // blocks are decoded independently (random access)
+        ima_decode_block(encoded.data() + block * block_size,
+            channels, rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE, decoded.data());
+
+        auto block_samples = samples.data() + block * frames_per_block * channels;
+
+        // block header keeps the first frame exact
+        for (uint32_t ch = 0; ch < channels; ++ch) {
+            ASSERT_EQ(decoded[ch], block_samples[ch]);
+        }
+
+        // step index adapts from zero in the first block, so compare energies, not max error
+        double signal_energy[channels] = {};
+        double error_energy[channels] = {};
+        for (uint32_t i = 0; i < frames_per_block * channels; ++i) {
+            double sample = block_samples[i];
+            double error = decoded[i] - sample;
+            signal_energy[i % channels] += sample * sample;
+            error_energy[i % channels] += error * error;
+        }
+
+        // SNR above 20dB
+        for (uint32_t ch = 0; ch < channels; ++ch) {
+            ASSERT_LT(error_energy[ch] * 100.0, signal_energy[ch]);
+        }
+    }
+}
+
+TEST(ima_adpcm, silence_round_trip)
+{
+    const uint32_t channels = 1;
+
+    std::vector<int16_t> samples(rt::ADPCM_SAMPLES_PER_BLOCK, 0);
+    std::vector<uint8_t> encoded(rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE);
+    ima_adpcm_state_t state = {};
+    ima_encode_block(&state, samples.data(), channels, rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE, encoded.data());
+
+    std::vector<int16_t> decoded(rt::ADPCM_SAMPLES_PER_BLOCK, 1);
+    ima_decode_block(encoded.data(), channels, rt::ADPCM_CHANNEL_BLOCK_BYTE_SIZE, decoded.data());
+
+    for (auto sample : decoded) {
+        // minimal step noise only
+        ASSERT_LE(abs(sample), 8);
+    }
+}
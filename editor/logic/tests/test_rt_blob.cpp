@@ -0,0 +1,619 @@
+#include "gtest/gtest.h"
+#include "data_types.h"
+
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace hle_audio;
+using namespace hle_audio::editor;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// state building helpers
+/////////////////////////////////////////////////////////////////////////////////////////
+
+static node_desc_t add_node(data_state_t& state, rt::node_type_e type) {
+    node_desc_t desc = {type, reserve_node_id(state.node_ids)};
+    create_node(&state, desc);
+    return desc;
+}
+
+static node_desc_t add_file(data_state_t& state, const char* filename) {
+    auto desc = add_node(state, rt::node_type_e::File);
+    get_file_node_mut(&state, desc.id).filename = (const char8_t*)filename;
+    return desc;
+}
+
+static node_desc_t add_parent(data_state_t& state, rt::node_type_e type, const std::vector<node_desc_t>& children) {
+    auto desc = add_node(state, type);
+    *get_child_nodes_ptr_mut(&state, desc) = children;
+    return desc;
+}
+
+static node_desc_t add_repeat(data_state_t& state, uint16_t repeat_count, const node_desc_t& node) {
+    auto desc = add_node(state, rt::node_type_e::Repeat);
+    auto& repeat_node = get_repeat_node_mut(&state, desc.id);
+    repeat_node.repeat_count = repeat_count;
+    repeat_node.node = node;
+    return desc;
+}
+
+static void add_group(data_state_t& state, const node_desc_t& node) {
+    named_group_t group = {};
+    group.name = "group_" + std::to_string(state.groups.size());
+    group.node = node;
+    state.groups.push_back(group);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// blob access, same as runtime does
+/////////////////////////////////////////////////////////////////////////////////////////
+
+struct blob_t {
+    std::vector<uint8_t> data;
+    rt::buffer_t buf;
+    const rt::store_t* store;
+};
+
+static blob_t build_blob(const data_state_t& state) {
+    blob_t blob = {};
+    blob.data = save_store_blob_buffer(&state, nullptr);
+    if (blob.data.empty()) return blob;
+
+    blob.buf.ptr = blob.data.data();
+    blob.store = ((const rt::root_header_t*)blob.data.data())->store.get_ptr(blob.buf);
+    return blob;
+}
+
+/**
+ * runtime group program interpreter, file indices of produced sounds
+ */
+static std::vector<uint32_t> run_program(const blob_t& blob, size_t group_index, std::mt19937& rng, size_t limit) {
+    auto& program = blob.store->groups.get(blob.buf, group_index).program;
+    auto ops = program.elements.get_ptr(blob.buf);
+
+    uint32_t pc = 0;
+    uint16_t loop_counters[rt::MAX_PROGRAM_LOOP_DEPTH] = {};
+    std::vector<uint32_t> sounds;
+    while (pc < program.count && sounds.size() < limit) {
+        auto& op = ops[pc++];
+        switch (op.type)
+        {
+        case rt::program_op_e::play:
+        case rt::program_op_e::play_loop:
+            sounds.push_back(op.arg);
+            break;
+        case rt::program_op_e::random:
+            pc += rng() % op.arg;
+            break;
+        case rt::program_op_e::jump:
+            pc = op.arg;
+            break;
+        case rt::program_op_e::loop_next: {
+            auto& counter = loop_counters[op.slot];
+            if (++counter < op.count) {
+                pc = op.arg;
+            } else {
+                counter = 0;
+            }
+            break;
+        }
+        }
+    }
+    return sounds;
+}
+
+static const rt::event_t* find_event(const blob_t& blob, const char* name) {
+    auto& event_index = blob.store->event_index;
+    if (!event_index.count) return nullptr;
+
+    auto entries = event_index.elements.get_ptr(blob.buf);
+    auto hash = rt::event_name_hash(name);
+    auto mask = event_index.count - 1;
+    for (auto slot = hash & mask; entries[slot].event_index != rt::EMPTY_EVENT_INDEX; slot = (slot + 1) & mask) {
+        if (entries[slot].name_hash != hash) continue;
+
+        auto& event = blob.store->events.get(blob.buf, entries[slot].event_index);
+        if (strcmp(event.name.get_ptr(blob.buf), name) == 0) return &event;
+    }
+    return nullptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// reference node tree walk
+/////////////////////////////////////////////////////////////////////////////////////////
+
+static bool can_play(const data_state_t& state, const node_desc_t& desc) {
+    switch (desc.type)
+    {
+    case rt::node_type_e::File:
+        return true;
+    case rt::node_type_e::Random:
+    case rt::node_type_e::Sequence:
+        for (auto& child : *get_child_nodes_ptr(&state, desc)) {
+            if (can_play(state, child)) return true;
+        }
+        return false;
+    case rt::node_type_e::Repeat:
+        return can_play(state, get_repeat_node(&state, desc.id).node);
+    default:
+        break;
+    }
+    return false;
+}
+
+struct node_walk_t {
+    const data_state_t* state;
+    std::mt19937* rng;
+    size_t limit;
+    std::vector<std::string> sounds;
+};
+
+/**
+ * append filenames node plays, silent subtrees are skipped without random choice
+ * @return false once limit is reached
+ */
+static bool walk(node_walk_t& w, const node_desc_t& desc) {
+    if (w.limit <= w.sounds.size()) return false;
+    if (!can_play(*w.state, desc)) return true;
+
+    switch (desc.type)
+    {
+    case rt::node_type_e::File: {
+        auto& filename = get_file_node(w.state, desc.id).filename;
+        w.sounds.push_back(std::string((const char*)filename.c_str()));
+        return w.sounds.size() < w.limit;
+    }
+    case rt::node_type_e::Random: {
+        auto& nodes = *get_child_nodes_ptr(w.state, desc);
+        return walk(w, nodes[(*w.rng)() % nodes.size()]);
+    }
+    case rt::node_type_e::Sequence: {
+        for (auto& child : *get_child_nodes_ptr(w.state, desc)) {
+            if (!walk(w, child)) return false;
+        }
+        return true;
+    }
+    case rt::node_type_e::Repeat: {
+        auto& repeat_node = get_repeat_node(w.state, desc.id);
+        for (uint32_t i = 0; repeat_node.repeat_count == 0 || i < repeat_node.repeat_count; ++i) {
+            if (!walk(w, repeat_node.node)) return false;
+        }
+        return true;
+    }
+    default:
+        break;
+    }
+    return true;
+}
+
+static std::vector<std::string> walk_group(const data_state_t& state, size_t group_index, std::mt19937& rng, size_t limit) {
+    node_walk_t w = {&state, &rng, limit, {}};
+    walk(w, state.groups[group_index].node);
+    return w.sounds;
+}
+
+/**
+ * file indices are assigned by blob writer, each filename should map to one index
+ */
+static bool is_same_sounds(const std::vector<std::string>& filenames, const std::vector<uint32_t>& file_indices) {
+    if (filenames.size() != file_indices.size()) return false;
+
+    std::unordered_map<std::string, uint32_t> indices;
+    std::unordered_map<uint32_t, std::string> names;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        auto index_it = indices.emplace(filenames[i], file_indices[i]).first;
+        auto name_it = names.emplace(file_indices[i], filenames[i]).first;
+        if (index_it->second != file_indices[i] || name_it->second != filenames[i]) return false;
+    }
+    return true;
+}
+
+static void expect_group_plays(const data_state_t& state, size_t group_index,
+        const std::vector<std::string>& expected, size_t limit = 100) {
+    auto blob = build_blob(state);
+    ASSERT_FALSE(blob.data.empty());
+
+    std::mt19937 rng(1);
+    ASSERT_EQ(walk_group(state, group_index, rng, limit), expected);
+
+    rng.seed(1);
+    EXPECT_TRUE(is_same_sounds(expected, run_program(blob, group_index, rng, limit)));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// group programs
+/////////////////////////////////////////////////////////////////////////////////////////
+
+TEST(rt_blob_program, sequence_plays_children_in_order)
+{
+    data_state_t state = {};
+    init(&state);
+
+    add_group(state, add_parent(state, rt::node_type_e::Sequence, {
+        add_file(state, "a"), add_file(state, "b"), add_file(state, "a")
+    }));
+
+    expect_group_plays(state, 0, {"a", "b", "a"});
+}
+
+TEST(rt_blob_program, looped_file_plays_with_loop_op)
+{
+    data_state_t state = {};
+    init(&state);
+
+    auto looped = add_file(state, "b");
+    get_file_node_mut(&state, looped.id).loop = true;
+    add_group(state, add_parent(state, rt::node_type_e::Sequence, {add_file(state, "a"), looped}));
+
+    expect_group_plays(state, 0, {"a", "b"});
+
+    auto blob = build_blob(state);
+    auto& program = blob.store->groups.get(blob.buf, 0).program;
+    ASSERT_EQ(program.count, 2u);
+    EXPECT_EQ(program.get(blob.buf, 0).type, rt::program_op_e::play);
+    EXPECT_EQ(program.get(blob.buf, 1).type, rt::program_op_e::play_loop);
+    EXPECT_EQ(program.get(blob.buf, 1).slot, 0u);
+}
+
+TEST(rt_blob_program, counted_repeat)
+{
+    data_state_t state = {};
+    init(&state);
+
+    add_group(state, add_repeat(state, 3, add_parent(state, rt::node_type_e::Sequence, {
+        add_file(state, "a"), add_file(state, "b")
+    })));
+    add_group(state, add_repeat(state, 1, add_file(state, "c")));
+
+    expect_group_plays(state, 0, {"a", "b", "a", "b", "a", "b"});
+    expect_group_plays(state, 1, {"c"});
+}
+
+TEST(rt_blob_program, infinite_repeat)
+{
+    data_state_t state = {};
+    init(&state);
+
+    add_group(state, add_parent(state, rt::node_type_e::Sequence, {
+        add_file(state, "intro"), add_repeat(state, 0, add_file(state, "loop"))
+    }));
+
+    std::vector<std::string> expected = {"intro"};
+    expected.resize(50, "loop");
+    expect_group_plays(state, 0, expected, expected.size());
+}
+
+TEST(rt_blob_program, nested_counted_repeats_restart_inner_counter)
+{
+    data_state_t state = {};
+    init(&state);
+
+    add_group(state, add_repeat(state, 2, add_parent(state, rt::node_type_e::Sequence, {
+        add_file(state, "a"), add_repeat(state, 3, add_file(state, "b"))
+    })));
+
+    expect_group_plays(state, 0, {"a", "b", "b", "b", "a", "b", "b", "b"});
+}
+
+TEST(rt_blob_program, loop_depth_limit)
+{
+    auto make_state = [](data_state_t& state, uint32_t counted_depth) {
+        init(&state);
+
+        auto node = add_file(state, "a");
+        for (uint32_t i = 0; i < counted_depth; ++i) {
+            // repeats of 0 and 1 don't take loop counters
+            node = add_repeat(state, 1, add_repeat(state, 2, add_repeat(state, 0, node)));
+        }
+        add_group(state, node);
+    };
+
+    data_state_t max_state = {};
+    make_state(max_state, rt::MAX_PROGRAM_LOOP_DEPTH);
+    EXPECT_FALSE(build_blob(max_state).data.empty());
+
+    data_state_t over_state = {};
+    make_state(over_state, rt::MAX_PROGRAM_LOOP_DEPTH + 1);
+    EXPECT_TRUE(build_blob(over_state).data.empty());
+}
+
+TEST(rt_blob_program, silent_subtrees_are_skipped)
+{
+    data_state_t state = {};
+    init(&state);
+
+    auto empty_sequence = add_parent(state, rt::node_type_e::Sequence, {});
+    add_group(state, add_parent(state, rt::node_type_e::Sequence, {
+        empty_sequence,
+        add_parent(state, rt::node_type_e::Random, {}),
+        add_node(state, rt::node_type_e::None),
+        add_repeat(state, 0, add_parent(state, rt::node_type_e::Sequence, {})),
+        add_repeat(state, 3, add_parent(state, rt::node_type_e::Random, {empty_sequence})),
+        add_file(state, "a")
+    }));
+    // nothing to play at all
+    add_group(state, add_repeat(state, 0, empty_sequence));
+
+    expect_group_plays(state, 0, {"a"});
+    expect_group_plays(state, 1, {});
+
+    auto blob = build_blob(state);
+    EXPECT_EQ(blob.store->groups.get(blob.buf, 0).program.count, 1u);
+    EXPECT_EQ(blob.store->groups.get(blob.buf, 1).program.count, 0u);
+}
+
+TEST(rt_blob_program, random_with_silent_choices)
+{
+    data_state_t state = {};
+    init(&state);
+
+    add_group(state, add_repeat(state, 0, add_parent(state, rt::node_type_e::Random, {
+        add_file(state, "a"),
+        add_parent(state, rt::node_type_e::Sequence, {}),
+        add_parent(state, rt::node_type_e::Sequence, {add_file(state, "b"), add_file(state, "c")}),
+        add_node(state, rt::node_type_e::None)
+    })));
+
+    auto blob = build_blob(state);
+    ASSERT_FALSE(blob.data.empty());
+    for (uint32_t seed = 0; seed < 100; ++seed) {
+        std::mt19937 rng(seed);
+        auto expected = walk_group(state, 0, rng, 50);
+
+        rng.seed(seed);
+        EXPECT_TRUE(is_same_sounds(expected, run_program(blob, 0, rng, 50))) << "seed " << seed;
+    }
+}
+
+TEST(rt_blob_program, random_trees_match_node_walk)
+{
+    std::mt19937 gen(1);
+    const char* filenames[] = {"f0", "f1", "f2", "f3", "f4", "f5", "f6"};
+
+    std::function<node_desc_t(data_state_t&, int)> gen_tree = [&](data_state_t& state, int depth) {
+        auto kind = depth <= 0 ? 0 : gen() % 5;
+        switch (kind)
+        {
+        case 0:
+            return gen() % 8 ? add_file(state, filenames[gen() % std::size(filenames)]) : add_node(state, rt::node_type_e::None);
+        case 1:
+        case 2: {
+            std::vector<node_desc_t> children(gen() % 4);
+            for (auto& child : children) child = gen_tree(state, depth - 1);
+            return add_parent(state, kind == 1 ? rt::node_type_e::Random : rt::node_type_e::Sequence, children);
+        }
+        default:
+            return add_repeat(state, uint16_t(gen() % 4), gen_tree(state, depth - 1));
+        }
+    };
+
+    uint32_t checked_count = 0;
+    for (int tree = 0; tree < 1000; ++tree) {
+        data_state_t state = {};
+        init(&state);
+        add_group(state, gen_tree(state, 1 + gen() % 6));
+
+        // too deep counted repeats are checked separately
+        auto blob = build_blob(state);
+        if (blob.data.empty()) continue;
+
+        // jumps stay within program
+        auto& program = blob.store->groups.get(blob.buf, 0).program;
+        for (uint32_t i = 0; i < program.count; ++i) {
+            auto& op = program.get(blob.buf, i);
+            if (op.type == rt::program_op_e::jump || op.type == rt::program_op_e::loop_next) {
+                ASSERT_LE(op.arg, program.count);
+            } else if (op.type == rt::program_op_e::random) {
+                ASSERT_LT(i + op.arg, program.count);
+            }
+        }
+
+        auto seed = gen();
+        std::mt19937 rng(seed);
+        auto expected = walk_group(state, 0, rng, 200);
+
+        rng.seed(seed);
+        ASSERT_TRUE(is_same_sounds(expected, run_program(blob, 0, rng, 200))) << "tree " << tree;
+        ++checked_count;
+    }
+    EXPECT_LT(900u, checked_count);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// event index
+/////////////////////////////////////////////////////////////////////////////////////////
+
+TEST(rt_blob_event_index, finds_present_names)
+{
+    data_state_t state = {};
+    init(&state);
+
+    const uint32_t event_count = 500;
+    for (uint32_t i = 0; i < event_count; ++i) {
+        event_t ev = {};
+        ev.name = "event_name_" + std::to_string(i);
+        ev.actions.push_back({rt::action_type_e::play, i, 0.0f});
+        state.events.push_back(ev);
+    }
+
+    auto blob = build_blob(state);
+    ASSERT_FALSE(blob.data.empty());
+
+    // power of 2, at most half full
+    auto& event_index = blob.store->event_index;
+    EXPECT_EQ(event_index.count & (event_index.count - 1), 0u);
+    EXPECT_LE(event_count * 2, event_index.count);
+
+    for (uint32_t i = 0; i < event_count; ++i) {
+        auto ev = find_event(blob, state.events[i].name.c_str());
+        ASSERT_NE(ev, nullptr) << state.events[i].name;
+        EXPECT_EQ(ev->actions.get(blob.buf, 0).target_index, i);
+    }
+}
+
+TEST(rt_blob_event_index, misses_absent_names)
+{
+    data_state_t state = {};
+    init(&state);
+
+    for (uint32_t i = 0; i < 500; ++i) {
+        event_t ev = {};
+        ev.name = "event_name_" + std::to_string(i);
+        state.events.push_back(ev);
+    }
+
+    auto blob = build_blob(state);
+    ASSERT_FALSE(blob.data.empty());
+
+    EXPECT_EQ(find_event(blob, ""), nullptr);
+    EXPECT_EQ(find_event(blob, "event_name_"), nullptr);
+    EXPECT_EQ(find_event(blob, "event_nam"), nullptr);
+    EXPECT_EQ(find_event(blob, "event_name_500"), nullptr);
+    EXPECT_EQ(find_event(blob, "event_name_4990"), nullptr);
+    for (uint32_t i = 0; i < 500; ++i) {
+        EXPECT_EQ(find_event(blob, ("event_name_x" + std::to_string(i)).c_str()), nullptr);
+        EXPECT_EQ(find_event(blob, ("Event_name_" + std::to_string(i)).c_str()), nullptr);
+    }
+}
+
+TEST(rt_blob_event_index, empty_bank)
+{
+    data_state_t state = {};
+    init(&state);
+
+    auto blob = build_blob(state);
+    ASSERT_FALSE(blob.data.empty());
+
+    EXPECT_EQ(blob.store->event_index.count, 0u);
+    EXPECT_EQ(find_event(blob, "event"), nullptr);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// shared stream file
+/////////////////////////////////////////////////////////////////////////////////////////
+
+class test_file_data_provider_t : public audio_file_data_provider_ti {
+public:
+    std::unordered_map<std::string, std::vector<uint8_t>> contents;
+
+    audio_file_data_t get_file_data(const char* filename, uint32_t, bool) override {
+        audio_file_data_t res = {};
+        res.content = contents[filename];
+        res.meta.coding_format = rt::audio_format_type_e::pcm;
+        res.meta.sample_rate = 48000;
+        res.meta.channels = 1;
+        res.meta.length_in_samples = res.content.size() / 2;
+        res.data_chunk_range.size = uint32_t(res.content.size());
+        return res;
+    }
+};
+
+static std::vector<rt::file_data_t> build_bank_file_data(test_file_data_provider_t& provider, 
+        stream_file_writer_t& writer, const std::vector<std::pair<const char*, bool>>& files) {
+    data_state_t state = {};
+    init(&state);
+
+    std::vector<node_desc_t> nodes;
+    for (auto& file : files) {
+        auto desc = add_file(state, file.first);
+        get_file_node_mut(&state, desc.id).stream = file.second;
+        nodes.push_back(desc);
+    }
+    add_group(state, add_parent(state, rt::node_type_e::Sequence, nodes));
+
+    std::vector<uint8_t> data = save_store_blob_buffer(&state, &provider, writer);
+
+    rt::buffer_t buf = {};
+    buf.ptr = data.data();
+    auto store = ((const rt::root_header_t*)data.data())->store.get_ptr(buf);
+
+    std::vector<rt::file_data_t> res;
+    for (uint32_t i = 0; i < store->file_data.count; ++i) {
+        res.push_back(store->file_data.get(buf, i));
+    }
+    return res;
+}
+
+static std::string stream_file_path(const char* name) {
+    return ::testing::TempDir() + name;
+}
+
+TEST(rt_blob_stream_writer, same_data_is_shared_between_banks)
+{
+    test_file_data_provider_t provider;
+    for (auto name : {"a", "a_copy", "resident_a", "resident_a_copy"}) {
+        provider.contents[name] = std::vector<uint8_t>(1000, 1);
+    }
+    for (auto name : {"b", "resident_b"}) {
+        provider.contents[name] = std::vector<uint8_t>(1000, 2);
+    }
+
+    auto path = stream_file_path("shared_stream_test.bin");
+    stream_file_writer_t writer = {};
+    ASSERT_TRUE(open(writer, path.c_str(), 0));
+    auto bank0 = build_bank_file_data(provider, writer, {{"a", true}, {"resident_a", false}, {"resident_b", false}});
+    auto bank1 = build_bank_file_data(provider, writer, {{"a_copy", true}, {"b", true}, {"resident_a_copy", false}});
+    close(writer);
+    ASSERT_EQ(bank0.size(), 3u);
+    ASSERT_EQ(bank1.size(), 3u);
+
+    // streamed
+    EXPECT_EQ(bank1[0].stream_data.offset, bank0[0].stream_data.offset);
+    EXPECT_NE(bank1[1].stream_data.offset, bank0[0].stream_data.offset);
+    EXPECT_EQ(writer.offset, 2000u);
+
+    // resident
+    EXPECT_NE(bank0[1].content_id, 0u);
+    EXPECT_EQ(bank1[2].content_id, bank0[1].content_id);
+    EXPECT_NE(bank0[2].content_id, bank0[1].content_id);
+    EXPECT_EQ(bank0[0].content_id, 0u);
+
+    remove(path.c_str());
+}
+
+// fnv-1a, same as the writer keys data by
+static uint64_t fnv1a(const std::vector<uint8_t>& data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (auto b : data) {
+        hash = (hash ^ b) * 1099511628211ull;
+    }
+    return hash;
+}
+
+TEST(rt_blob_stream_writer, hash_match_is_compared_by_bytes)
+{
+    test_file_data_provider_t provider;
+    provider.contents["a"] = std::vector<uint8_t>(1000, 1);
+    provider.contents["b"] = std::vector<uint8_t>(1000, 2);
+
+    auto path = stream_file_path("collision_stream_test.bin");
+    stream_file_writer_t writer = {};
+    ASSERT_TRUE(open(writer, path.c_str(), 0));
+    auto bank0 = build_bank_file_data(provider, writer, {{"a", true}});
+
+    // fake collision, data of "b" hashes to written "a"
+    writer.written_data.emplace(fnv1a(provider.contents["b"]), bank0[0].stream_data);
+
+    auto bank1 = build_bank_file_data(provider, writer, {{"b", true}, {"a", true}});
+    close(writer);
+    ASSERT_EQ(bank1.size(), 2u);
+
+    EXPECT_NE(bank1[0].stream_data.offset, bank0[0].stream_data.offset);
+    EXPECT_EQ(bank1[1].stream_data.offset, bank0[0].stream_data.offset);
+    EXPECT_EQ(writer.offset, 2000u);
+
+    // written data isn't overwritten by comparing reads
+    std::vector<uint8_t> file_data(2000);
+    auto f = fopen(path.c_str(), "rb");
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(fread(file_data.data(), 1, file_data.size(), f), file_data.size());
+    fclose(f);
+    EXPECT_EQ(std::vector<uint8_t>(file_data.begin(), file_data.begin() + 1000), provider.contents["a"]);
+    EXPECT_EQ(std::vector<uint8_t>(file_data.begin() + 1000, file_data.end()), provider.contents["b"]);
+
+    remove(path.c_str());
+}
@@ -273,8 +273,8 @@ public:
     rt::editor_runtime_t* editor_rt;
     data::file_data_provider_t fd_prov = {};
 
-    audio_file_data_t get_file_data(const char* filename, uint32_t file_index) override {
-        auto res = fd_prov.get_file_data(filename, file_index);
+    audio_file_data_t get_file_data(const char* filename, uint32_t file_index, bool stream) override {
+        auto res = fd_prov.get_file_data(filename, file_index, stream);
 
         cache_audio_file_data(editor_rt, filename, file_index, res.data_chunk_range);
 
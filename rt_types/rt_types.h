@@ -32,6 +32,12 @@ struct range_t {
     uint32_t size;
 };
 
+// byte range in streaming file, which could be over 4GB
+struct stream_range_t {
+    uint64_t offset;
+    uint64_t size;
+};
+
 static bool is_empty(data_buffer_t buf) {
     return buf.size == 0;
 }
@@ -68,7 +74,7 @@ struct array_view_t {
 // rt blob types
 //
 
-static const uint32_t STORE_BLOB_VERSION = 5;
+static const uint32_t STORE_BLOB_VERSION = 13;
 
 enum class node_type_e : uint8_t {
     None,
@@ -90,27 +96,29 @@ static const char* node_type_name(node_type_e type) {
     return c_node_type_names[(size_t)type];
 }
 
-struct file_node_t {
-    uint32_t file_index;
-    uint8_t loop;
-};
-
-struct node_desc_t {
-    node_type_e type;
-    uint16_t index;
-};
-
-struct random_node_t {
-    array_view_t<node_desc_t> nodes;
+/**
+ * group node tree compiled by tool into flat op list,
+ * runtime runs ops from group program start till play op produces next sound
+ */
+enum class program_op_e : uint8_t {
+    play,       // arg: file index
+    play_loop,  // arg: file index, sound loops till stopped
+    random,     // arg: choice count (not 0), followed by jump op per choice
+    jump,       // arg: target op index
+    loop_next   // arg: loop body op index, count: repeat count, slot: loop counter
 };
 
-struct sequence_node_t {
-    array_view_t<node_desc_t> nodes;
-};
-
-struct repeat_node_t {
-    uint16_t repeat_count;
-    node_desc_t node;
+// nesting of finite repeat nodes, size of per group loop counters
+static const uint8_t MAX_PROGRAM_LOOP_DEPTH = 8;
+
+/**
+ * fields meaning depends on op type (see program_op_e), unused ones are 0
+ */
+struct program_op_t {
+    program_op_e type;
+    uint8_t slot;   // loop counter index, < MAX_PROGRAM_LOOP_DEPTH
+    uint16_t count; // loop repeat count
+    uint32_t arg;
 };
 
 struct named_group_t {
@@ -118,7 +126,7 @@ struct named_group_t {
     float volume = 1.0;
     float cross_fade_time = 0.0;
     uint8_t output_bus_index = 0;
-    node_desc_t node;
+    array_view_t<program_op_t> program;
 };
 
 enum class action_type_e : uint8_t {
@@ -132,7 +140,8 @@ enum class action_type_e : uint8_t {
     pause_bus,
     resume_bus,
     stop_bus,
-    stop_all
+    stop_all,
+    prepare
 };
 
 static const char* const c_action_type_names[] = {
@@ -146,7 +155,8 @@ static const char* const c_action_type_names[] = {
     "pause_bus",
     "resume_bus",
     "stop_bus",
-    "stop_all"
+    "stop_all",
+    "prepare"
 };
 
 static const char* action_type_name(action_type_e type) {
@@ -164,13 +174,44 @@ struct event_t {
     array_view_t<action_t> actions;
 };
 
+static const uint32_t EMPTY_EVENT_INDEX = ~0u;
+
+/**
+ * event name hash table slot, table size is power of 2 with linear probing,
+ * so lookup touches event name only on hash match
+ */
+struct event_index_entry_t {
+    uint32_t name_hash;
+    uint32_t event_index; // EMPTY_EVENT_INDEX for free slot
+};
+
+// fnv-1a
+static uint32_t event_name_hash(const char* str) {
+    uint32_t hash = 2166136261u;
+    for (; *str; ++str) {
+        hash = (hash ^ uint8_t(*str)) * 16777619u;
+    }
+    return hash;
+}
+
 enum class audio_format_type_e : uint8_t {
     none,
     pcm,
     mp3,
-    vorbis
+    vorbis,
+    adpcm,
+    flac
 };
 
+/**
+ * IMA ADPCM block is a sequence of per channel blocks (planar):
+ *  [int16 predictor | uint8 step index | uint8 reserved | 4 bit samples, low nibble first]
+ * header predictor is the first sample of the block
+ */
+static const uint32_t ADPCM_CHANNEL_BLOCK_BYTE_SIZE = 256;
+static const uint32_t ADPCM_BLOCK_HEADER_BYTE_SIZE = 4;
+static const uint32_t ADPCM_SAMPLES_PER_BLOCK = 1 + (ADPCM_CHANNEL_BLOCK_BYTE_SIZE - ADPCM_BLOCK_HEADER_BYTE_SIZE) * 2;
+
 struct file_data_t {
     struct meta_t {
         audio_format_type_e coding_format;
@@ -182,18 +223,30 @@ struct file_data_t {
         uint8_t             channels;
     };
 
+    /**
+     * byte offsets of every frames_per_entry-th frame in data buffer (mp3),
+     * empty for formats without frames table
+     */
+    struct frame_seek_table_t {
+        uint32_t samples_per_frame;
+        uint32_t frames_per_entry;
+        array_view_t<uint32_t> frame_offsets;
+    };
+
     meta_t meta;
-    array_view_t<uint8_t> data_buffer;
+    uint32_t content_id;               // resident data identity among banks built with one streaming file, 0 if unknown
+    array_view_t<uint8_t> data_buffer; // resident data in blob
+    stream_range_t stream_data;        // streamed data in streaming file
+    frame_seek_table_t seek_table;
+
+    // resident copy of streamed data start (in blob), empty if not stored
+    array_view_t<uint8_t> stream_head;
 };
 
 struct store_t {
-    array_view_t<file_node_t> nodes_file;
-    array_view_t<random_node_t> nodes_random;
-    array_view_t<sequence_node_t> nodes_sequence;
-    array_view_t<repeat_node_t> nodes_repeat;
-
     array_view_t<named_group_t> groups;
     array_view_t<event_t> events;
+    array_view_t<event_index_entry_t> event_index;
 
     array_view_t<file_data_t> file_data;
 };
@@ -201,6 +254,13 @@ struct store_t {
 struct root_header_t {
     uint32_t version = STORE_BLOB_VERSION;
     offset_typed_t<store_t> store;
+
+    // streamed files data offsets in stream file are multiple of it, 0 if packed
+    uint32_t stream_alignment;
+
+    // resident sample data is the blob tail from this offset, bank could be loaded without it
+    // and read files data on demand
+    offset_t resident_data_offset;
 };
 
 }
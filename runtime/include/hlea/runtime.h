@@ -15,13 +15,71 @@ struct hlea_context_create_info_t {
     const hlea_file_ti* file_api_vt;
     void* file_sys;
 
+    // should be thread-safe, shared decoder scratch pool grows from job threads
     const hlea_allocator_ti* allocator_vt;
     void* allocator_udata;
 
     const hlea_jobs_ti* jobs_vt;
     void* jobs_udata;
 
+    /**
+     * default work-stealing pool setup, used if jobs_vt is null,
+     * worker count is hardware concurrency - 1 if 0, pinned workers skip cpu 0
+     */
+    uint8_t job_worker_count;
+    bool pin_job_workers;
+
     uint8_t output_bus_count;
+
+    /**
+     * stereo voices initialized per output bus upfront, voices are reused for later plays,
+     * default is used if 0
+     */
+    uint16_t prewarm_voice_count;
+
+    /**
+     * map bank stream files into memory instead of copying chunks with the reader thread,
+     * used only with the default file api (file_api_vt is null), falls back to reading otherwise
+     */
+    bool use_mapped_streaming;
+
+    /**
+     * length of decoded ahead audio per mp3 voice in ms, larger ring means fewer decode jobs
+     * and larger contiguous reads, default is used if 0
+     */
+    uint16_t mp3_output_ring_ms;
+
+    /**
+     * decode mp3 to s16 instead of f32, halves output ring memory per voice
+     */
+    bool mp3_s16_output;
+
+    /**
+     * length of streamed sound start decoded ahead by prepare, default is used if 0
+     */
+    uint16_t prepare_ms;
+
+    /**
+     * decoding jobs of all voices are gathered once per audio period and launched as this many batches,
+     * default is used if 0
+     */
+    uint8_t decode_batch_count;
+
+    /**
+     * short resident compressed sounds are decoded once into shared lru cache,
+     * defaults are used if 0
+     */
+    bool disable_pcm_cache;
+    uint32_t pcm_cache_budget;
+    uint32_t pcm_cache_max_entry_size;
+
+    /**
+     * if not 0, banks loaded from file (sync or async) keep resident sample data on disk
+     * and read it per sound file on first play or preload, unused data over the budget is evicted,
+     * play doesn't block on the read, sound starts producing output once its data is read,
+     * same data of banks built with shared stream file is read and kept once
+     */
+    uint32_t resident_data_budget;
 };
 
 hlea_context_t* hlea_create(hlea_context_create_info_t* info);
@@ -32,11 +90,40 @@ void hlea_wakeup(hlea_context_t* ctx);
 
 /**
  * banks
+ * banks with the same stream_bank_filename (built together with shared stream file) share it,
+ * file is open till the last of them is unloaded
  */
 hlea_event_bank_t* hlea_load_events_bank(hlea_context_t* ctx, const char* bank_filename, const char* stream_bank_filename);
 hlea_event_bank_t* hlea_load_events_bank_from_buffer(hlea_context_t* ctx, const uint8_t* buf, size_t buf_size);
+
+/**
+ * use bank blob without copying, memory is borrowed and can be read-only (e.g. mapped),
+ * it should be 8 bytes aligned and stay valid until the bank is unloaded
+ */
+hlea_event_bank_t* hlea_load_events_bank_in_place(hlea_context_t* ctx, const void* data, size_t data_size);
+
+/**
+ * map bank file read-only and use it in place (pages are shared between processes),
+ * falls back to hlea_load_events_bank if mapping is not possible or custom file api is used
+ */
+hlea_event_bank_t* hlea_load_events_bank_mapped(hlea_context_t* ctx, const char* bank_filename, const char* stream_bank_filename);
 void hlea_unload_events_bank(hlea_context_t* ctx, hlea_event_bank_t* bank);
 
+/**
+ * async banks loading, files are opened and blob is validated on jobs, blob is read with async reader.
+ * loading progresses in hlea_process_frame, events fired before bank is ready are ignored.
+ * bank in any state should be unloaded with hlea_unload_events_bank (it waits for in-flight work)
+ */
+hlea_event_bank_t* hlea_load_events_bank_async(hlea_context_t* ctx, const char* bank_filename, const char* stream_bank_filename);
+
+enum class hlea_bank_state_e {
+    loading,
+    ready,
+    failed
+};
+hlea_bank_state_e hlea_get_bank_state(hlea_context_t* ctx, const hlea_event_bank_t* bank);
+bool hlea_is_bank_ready(hlea_context_t* ctx, const hlea_event_bank_t* bank);
+
 /**
  * events api
  */
@@ -45,6 +132,19 @@ void hlea_process_frame(hlea_context_t* ctx);
 
 void hlea_fire_event(hlea_context_t* ctx, hlea_event_bank_t* bank, const char* eventName, uint32_t obj_id);
 
+/**
+ * prepare groups played by event for obj_id: first sound is made, streamed one is read and decoded
+ * ahead in hlea_process_frame, so the play starts from buffered data.
+ * prepared group is released by stop of the group or bank unload
+ */
+void hlea_prepare_event(hlea_context_t* ctx, hlea_event_bank_t* bank, const char* eventName, uint32_t obj_id);
+
+/**
+ * hint to start reading resident sample data of group sounds, so their first play doesn't start late,
+ * does nothing if bank resident data is loaded with the bank
+ */
+void hlea_preload_group(hlea_context_t* ctx, hlea_event_bank_t* bank, uint32_t group_index);
+
 enum class hlea_action_type_e {
     play_single,
     play,
@@ -55,7 +155,8 @@ enum class hlea_action_type_e {
     pause_bus,
     resume_bus,
     stop_bus,
-    stop_all
+    stop_all,
+    prepare // make group first sound ahead, next play of group and obj_id starts it
 };
 
 struct hlea_action_info_t {
@@ -76,6 +177,35 @@ void hlea_fire_event(hlea_context_t* ctx, const hlea_fire_event_info_t* event_in
 void hlea_set_main_volume(hlea_context_t* ctx, float volume);
 void hlea_set_bus_volume(hlea_context_t* ctx, uint8_t bus_index, float volume);
 
+// stats
+struct hlea_stats_t {
+    uint32_t pcm_cache_hits;
+    uint32_t pcm_cache_misses;
+    uint32_t pcm_cache_entry_count;
+    size_t pcm_cache_used_bytes;
+
+    // per voice memory, shared aux pool is accounted separately
+    uint32_t mp3_decoder_count;
+    uint32_t mp3_decoder_bytes;
+    size_t mp3_aux_pool_bytes;
+
+    // initialized engine sounds, reused count tells plays without node init
+    uint32_t voice_count;
+    uint32_t free_voice_count;
+    uint32_t reused_voice_count;
+
+    // streamed sound plays started with prepared data, cold ones could start late
+    uint32_t prepared_start_count;
+    uint32_t cold_start_count;
+
+    // on demand read resident sample data, misses are plays started before their data was read
+    uint32_t resident_data_hits;
+    uint32_t resident_data_misses;
+    uint32_t resident_data_entry_count;
+    size_t resident_data_used_bytes;
+};
+void hlea_get_stats(hlea_context_t* ctx, hlea_stats_t* out_stats);
+
 /** 
  * editor api
  * todo: move out of public header to its own implemenation files
@@ -9,6 +9,7 @@
 #include <chrono>
 
 #include "miniaudio_public.h"
+#include "mapped_file.h"
 
 using namespace std::chrono_literals;
 
@@ -88,16 +89,25 @@ static void process_async_reader(async_file_reader_t* reader) {
             async_read_request_t req = reader->read_requests[req_index];
             reader->read_request_indices.read_pos++;
 
-            // todo: ? sync with start_async_reading ?
-            auto file = reader->opened_files[req.file - 1].file;
-
             if (ENABLE_DEBUG_READ_DELAY) {
                 std::this_thread::sleep_for(DEBUG_READ_DELAY);
             }
-            
-            ma_vfs_seek(reader->vfs, file, req.offset, ma_seek_origin_start);
-            size_t read_bytes = {};
-            ma_vfs_read(reader->vfs, file, req.out_buffer.data, req.out_buffer.size, &read_bytes);
+
+            if (req.file == invalid_async_file_handle) {
+                // prefetch request, out_buffer is mapped memory range
+                const_data_buffer_t range = {};
+                range.data = req.out_buffer.data;
+                range.size = req.out_buffer.size;
+                prefetch_mapped_range(range);
+            } else {
+                // todo: ? sync with start_async_reading ?
+                auto file = reader->opened_files[req.file - 1].file;
+
+                ma_vfs_seek(reader->vfs, file, ma_int64(req.offset), ma_seek_origin_start);
+                size_t read_bytes = {};
+                ma_vfs_read(reader->vfs, file, req.out_buffer.data, req.out_buffer.size, &read_bytes);
+                if (req.out_read_size) *req.out_read_size = read_bytes;
+            }
 
             reader->read_pos_processed = reader->read_request_indices.read_pos.load();
         }
@@ -145,14 +155,22 @@ async_file_handle_t start_async_reading(async_file_reader_t* reader, ma_vfs_file
     return async_file_handle_t(file_index + 1);
 }
 
-void stop_async_reading(async_file_reader_t* reader, async_file_handle_t afile) {
-    // respect queued read requests, wait for all pending reads (too strict now - wait for reads even from other files)
-    // todo: consider non-blocking solution, waiting read per file
+void wait_all_requests(async_file_reader_t* reader) {
     auto wp = async_read_token_t(reader->read_request_indices.write_pos.load());
     while (check_request_running(reader, wp)) {
         std::this_thread::sleep_for(1ms);
     }
+}
+
+void stop_async_reading(async_file_reader_t* reader, async_file_handle_t afile) {
+    // respect queued read requests, wait for all pending reads (too strict now - wait for reads even from other files)
+    // todo: consider non-blocking solution, waiting read per file
+    wait_all_requests(reader);
     
+    release_async_file(reader, afile);
+}
+
+void release_async_file(async_file_reader_t* reader, async_file_handle_t afile) {
     reader->opened_files_freed[reader->opened_files_freed_count++] = afile;
 }
 
@@ -188,6 +206,15 @@ async_read_token_t request_read(async_file_reader_t* reader, const async_read_re
     return res;
 }
 
+async_read_token_t request_prefetch(async_file_reader_t* reader, const_data_buffer_t mapped_range) {
+    async_read_request_t req = {};
+    req.file = invalid_async_file_handle;
+    req.out_buffer.data = const_cast<uint8_t*>(mapped_range.data); // read only
+    req.out_buffer.size = mapped_range.size;
+
+    return request_read(reader, req);
+}
+
 // thread-safe
 bool check_request_running(const async_file_reader_t* reader, async_read_token_t token) {
     auto last_req = reader->read_request_indices.write_pos.load();
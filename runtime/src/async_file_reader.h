@@ -29,16 +29,34 @@ void destroy(async_file_reader_t* reader);
 async_file_handle_t start_async_reading(async_file_reader_t* reader, ma_vfs_file f);
 void stop_async_reading(async_file_reader_t* reader, async_file_handle_t afile);
 
+/**
+ * @brief non-blocking stop_async_reading, caller guarantees all reads of the file are finished
+ */
+void release_async_file(async_file_reader_t* reader, async_file_handle_t afile);
+
 enum async_read_token_t : uint32_t;
 
 struct async_read_request_t {
     async_file_handle_t file;
-    uint32_t offset;
+    uint64_t offset;
     data_buffer_t out_buffer;
+    size_t* out_read_size; // optional, bytes actually read, set once request is done
 };
 
 async_read_token_t request_read(async_file_reader_t* reader, const async_read_request_t& request);
+
+/**
+ * @brief queue prefetch of a mapped memory range on the reader thread (see prefetch_mapped_range),
+ * completion is tracked with the same tokens as reads
+ */
+async_read_token_t request_prefetch(async_file_reader_t* reader, const_data_buffer_t mapped_range);
+
 bool check_request_running(const async_file_reader_t* reader, async_read_token_t token);
 
+/**
+ * @brief blocks until all requests queued so far are processed
+ */
+void wait_all_requests(async_file_reader_t* reader);
+
 }
 }
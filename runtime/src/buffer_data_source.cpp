@@ -7,12 +7,36 @@
 namespace hle_audio {
 namespace rt {
 
+static ma_result buffer_data_source_seek(ma_data_source* data_source, ma_uint64 frameIndex);
+
 static ma_result buffer_data_source_read(ma_data_source* data_source, void* frames_out, ma_uint64 frame_count, ma_uint64* frames_read) {
     buffer_data_source_t* src = (buffer_data_source_t*)data_source;
 
     uint8_t channels = src->meta.channels;
     const auto sample_byte_size = get_sample_byte_size(src->format);
 
+    // decoder could produce a bit more than meta length (e.g. vorbis last page)
+    frame_count = std::min(frame_count, src->meta.length_in_samples - src->read_cursor);
+    if (frame_count == 0) return MA_SUCCESS;
+
+    // cached, just copy
+    if (src->decoded_frames) {
+        const auto frame_byte_size = sample_byte_size * channels;
+        memcpy(frames_out, (const uint8_t*)src->decoded_frames + src->read_cursor * frame_byte_size, size_t(frame_count * frame_byte_size));
+        src->read_cursor += frame_count;
+        *frames_read = frame_count;
+
+        return MA_SUCCESS;
+    }
+
+    // start decoding once buffer is read, from the cursor it was seeked to meanwhile
+    if (src->input_reader) {
+        if (check_request_running(src->input_reader, src->input_read_token)) return MA_BUSY;
+
+        src->input_reader = nullptr;
+        buffer_data_source_seek(data_source, src->read_cursor);
+    }
+
     // acquire ready output buffer
     if (is_empty(src->read_buffer) || (src->read_buffer.size == src->read_bytes)) {
         src->read_bytes = 0;
@@ -46,6 +70,10 @@ static ma_result buffer_data_source_read(ma_data_source* data_source, void* fram
 
     *frames_read = bytes_consumed / (sample_byte_size * channels);
 
+    if (src->fill_entry) {
+        fill(src->fill_entry, src->read_cursor, frames_out, *frames_read);
+    }
+
     src->read_cursor += *frames_read;
 
     assert(src->read_cursor <= src->meta.length_in_samples);
@@ -56,15 +84,23 @@ static ma_result buffer_data_source_read(ma_data_source* data_source, void* fram
 static ma_result buffer_data_source_seek(ma_data_source* data_source, ma_uint64 frameIndex) {
     buffer_data_source_t* ds = (buffer_data_source_t*)data_source;
 
+    if (ds->decoded_frames || ds->input_reader) {
+        ds->read_cursor = frameIndex;
+        return MA_SUCCESS;
+    }
+
     uint8_t channels = ds->meta.channels;
     const auto sample_byte_size = get_sample_byte_size(ds->format);
 
+    auto seek_input = find_seek_input(ds->meta, ds->seek_info, frameIndex);
+    data_buffer_t input = advance(ds->buffer, size_t(seek_input.input_offset));
+
     flush(ds->decoder);
-    queue_input(ds->decoder, ds->buffer, true);
+    queue_input(ds->decoder, input, true);
     ds->read_buffer = {};
     ds->read_bytes = 0;
     ds->read_cursor = frameIndex;
-    ds->skip_read_bytes = frameIndex * sample_byte_size * channels;
+    ds->skip_read_bytes = seek_input.skip_frames * sample_byte_size * channels;
     
     return MA_SUCCESS;
 }
@@ -127,14 +163,23 @@ ma_result buffer_data_source_init(buffer_data_source_t* data_source, const buffe
     data_source->format = info.format;
     data_source->meta = info.meta;
     data_source->buffer = info.buffer;
+    data_source->seek_info = info.seek_info;
+    data_source->decoded_frames = info.decoded_frames;
+    data_source->fill_entry = info.fill_entry;
+    if (!data_source->decoded_frames) {
+        data_source->input_reader = info.input_reader;
+        data_source->input_read_token = info.input_read_token;
+    }
 
-    queue_input(data_source->decoder, data_source->buffer, true);
+    if (!data_source->decoded_frames && !data_source->input_reader) {
+        queue_input(data_source->decoder, data_source->buffer, true);
+    }
 
     return MA_SUCCESS;
 }
 
 void buffer_data_source_uninit(buffer_data_source_t* data_source) {
-    assert(!is_running(data_source->decoder) && "decoder should have released its inputs");
+    assert((data_source->decoded_frames || !is_running(data_source->decoder)) && "decoder should have released its inputs");
 
     // uninitialize the base data source.
     ma_data_source_uninit(&data_source->base);
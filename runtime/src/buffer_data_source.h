@@ -3,6 +3,9 @@
 #include "miniaudio_public.h"
 #include "rt_types.h"
 #include "decoder.h"
+#include "pcm_cache.h"
+#include "frame_seek.h"
+#include "async_file_reader.h"
 
 namespace hle_audio {
 namespace rt {
@@ -14,6 +17,16 @@ struct buffer_data_source_t {
     ma_format format;
     file_data_t::meta_t meta;
     data_buffer_t buffer;
+    frame_seek_info_t seek_info;
+
+    // fully decoded sound from pcm cache, decoder is not used if set
+    const void* decoded_frames;
+    // pcm cache entry filled with decoded output
+    pcm_cache_entry_t* fill_entry;
+
+    // buffer is still being read, decoder input is queued once the read is done
+    const async_file_reader_t* input_reader;
+    async_read_token_t input_read_token;
 
     ma_uint64 read_cursor;
 
@@ -30,6 +43,14 @@ struct buffer_data_source_init_info_t {
     ma_format format;
     file_data_t::meta_t meta;
     data_buffer_t buffer;
+    frame_seek_info_t seek_info;
+
+    const void* decoded_frames;
+    pcm_cache_entry_t* fill_entry;
+
+    // optional, pending read filling the buffer
+    const async_file_reader_t* input_reader;
+    async_read_token_t input_read_token;
 };
 
 ma_result buffer_data_source_init(buffer_data_source_t* ds, const buffer_data_source_init_info_t& info);
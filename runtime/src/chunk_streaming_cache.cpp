@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <mutex>
+#include <algorithm>
 
 #include "alloc_utils.inl"
 #include "hash_indices.inl"
@@ -11,6 +12,7 @@
 static const size_t READ_CHUNK_SIZE = 64 * 1024; // 64KB
 static const size_t MAX_SOURCES_COUNT = 512;
 static const size_t MAX_POOL_CHUNKS = 32; // 2MB total
+static const size_t CHUNK_BUFFER_ALIGNMENT = 4096; // page, fits direct io
 
 namespace hle_audio {
 namespace rt {
@@ -21,6 +23,8 @@ struct index_with_generation_t {
 };
 
 // chunks states: unused, filling(writing into buffer from file), reading (by decoder with refcounting)
+// mapped sources chunks don't own chunks_buffer memory, they are views into the mapping
+// and chunk state only tracks page residency (prefetching -> ready)
 struct chunk_streaming_cache_t {
     allocator_t allocator;
     async_file_reader_t* async_io;
@@ -29,20 +33,24 @@ struct chunk_streaming_cache_t {
 
     struct source_t {
         async_file_handle_t file;
+        const_data_buffer_t mapped; // set for memory mapped sources, file is not used then
+        uint32_t read_alignment;
         uint16_t generation;
     };
     source_t sources[MAX_SOURCES_COUNT];
 
     struct chunk_t {
         streaming_source_handle src;
-        uint32_t src_offset;
+        uint64_t src_offset;
+        uint32_t data_shift; // requested offset in chunk buffer, read starts aligned before it
 
         uint32_t use_count;
         chunk_status_e status;
     };
 
     chunk_t chunks[MAX_POOL_CHUNKS];
-    uint8_t* chunks_buffer;
+    uint8_t* chunks_buffer; // aligned start in chunks_allocation
+    uint8_t* chunks_allocation;
 
     struct pending_read_t {
         async_read_token_t read_token;
@@ -74,8 +82,9 @@ static index_with_generation_t unpack(streaming_source_handle h) {
     return index;
 }
 
-static uint32_t hash_src_pos(streaming_source_handle src, uint32_t src_offset) {
-    uint32_t res = hash_combine(distribute(src_offset), (uint32_t)src);
+static uint32_t hash_src_pos(streaming_source_handle src, uint64_t src_offset) {
+    uint32_t res = hash_combine(distribute(uint32_t(src_offset)), uint32_t(src_offset >> 32));
+    res = hash_combine(res, (uint32_t)src);
     res += (res == 0) ? 1u : 0u; // zero hash is used as free slot marker
     return res;
 }
@@ -91,7 +100,9 @@ chunk_streaming_cache_t* create_cache(const chunk_streaming_cache_init_info_t& i
     memset(cache->chunks, 0, sizeof(cache->chunks));
 
     // todo: make single allocation
-    cache->chunks_buffer = (uint8_t*)allocate(info.allocator, MAX_POOL_CHUNKS * READ_CHUNK_SIZE);
+    // allocator could ignore large alignments, so align inside larger allocation
+    cache->chunks_allocation = (uint8_t*)allocate(info.allocator, MAX_POOL_CHUNKS * READ_CHUNK_SIZE + CHUNK_BUFFER_ALIGNMENT - 1);
+    cache->chunks_buffer = (uint8_t*)((uintptr_t(cache->chunks_allocation) + CHUNK_BUFFER_ALIGNMENT - 1) & ~uintptr_t(CHUNK_BUFFER_ALIGNMENT - 1));
 
     init(&cache->free_chunks, cache->free_chunk_entries, MAX_POOL_CHUNKS);
 
@@ -107,18 +118,24 @@ chunk_streaming_cache_t* create_cache(const chunk_streaming_cache_init_info_t& i
 
 void destroy(chunk_streaming_cache_t* cache) {
     // todo: make sure chunks_buffer is not used for reading
-    deallocate(cache->allocator, cache->chunks_buffer);
+    deallocate(cache->allocator, cache->chunks_allocation);
 
     cache->~chunk_streaming_cache_t();
     deallocate(cache->allocator, cache);
 }
 
-streaming_source_handle register_source(chunk_streaming_cache_t* cache, async_file_handle_t file) {
+static bool is_source_used(const chunk_streaming_cache_t::source_t& src) {
+    return src.file != invalid_async_file_handle || src.mapped.data;
+}
+
+static streaming_source_handle register_source(chunk_streaming_cache_t* cache, async_file_handle_t file, const_data_buffer_t mapped, uint32_t read_alignment) {
     std::unique_lock<std::mutex> lk(cache->sync_mutex);
 
     for (auto& src : cache->sources) {
-        if (src.file == invalid_async_file_handle) {
+        if (!is_source_used(src)) {
             src.file = file;
+            src.mapped = mapped;
+            src.read_alignment = read_alignment;
 
             index_with_generation_t index_gen = {};
             index_gen.index = &src - cache->sources; 
@@ -131,6 +148,18 @@ streaming_source_handle register_source(chunk_streaming_cache_t* cache, async_fi
     return {};
 }
 
+streaming_source_handle register_source(chunk_streaming_cache_t* cache, async_file_handle_t file, uint32_t read_alignment) {
+    // chunk should fit aligned read
+    bool valid_alignment = (read_alignment & (read_alignment - 1)) == 0 && read_alignment <= READ_CHUNK_SIZE;
+    assert(valid_alignment);
+    return register_source(cache, file, {}, valid_alignment ? read_alignment : 0);
+}
+
+streaming_source_handle register_mapped_source(chunk_streaming_cache_t* cache, const_data_buffer_t mapped) {
+    assert(mapped.data);
+    return register_source(cache, invalid_async_file_handle, mapped, 0);
+}
+
 // todo: do something with files in flight?
 void deregister_source(chunk_streaming_cache_t* cache, streaming_source_handle src) {
     std::unique_lock<std::mutex> lk(cache->sync_mutex);
@@ -141,6 +170,8 @@ void deregister_source(chunk_streaming_cache_t* cache, streaming_source_handle s
     assert(src_data.generation == index.generation);
 
     src_data.file = invalid_async_file_handle;
+    src_data.mapped = {};
+    src_data.read_alignment = 0;
     ++src_data.generation;
 }
 
@@ -151,12 +182,19 @@ chunk_request_result_t acquire_chunk(chunk_streaming_cache_t& cache, const chunk
     res.index = ~0u;
 
     assert(request.block_offset < request.buffer_block.size);
-    
-    auto rest_size = request.buffer_block.size - request.block_offset;
-    auto buf_size = rest_size < READ_CHUNK_SIZE ? rest_size : READ_CHUNK_SIZE;
 
     auto req_src_offset = request.buffer_block.offset + request.block_offset;
 
+    // aligned read starts before requested offset, so less of the chunk is left for data
+    auto src_index = unpack(request.src);
+    const auto& src_data = cache.sources[src_index.index];
+    assert(src_data.generation == src_index.generation && "Accessing the source after deregister!");
+
+    uint32_t data_shift = src_data.read_alignment ? uint32_t(req_src_offset & (src_data.read_alignment - 1)) : 0;
+
+    auto rest_size = request.buffer_block.size - request.block_offset;
+    auto buf_size = size_t(std::min<uint64_t>(rest_size, READ_CHUNK_SIZE - data_shift));
+
     // try find chunk in cache
     auto req_key_hash = hash_src_pos(request.src, req_src_offset);
     auto ch_index = hash::find_index(&cache.chunk_indices, req_key_hash, 
@@ -173,7 +211,9 @@ chunk_request_result_t acquire_chunk(chunk_streaming_cache_t& cache, const chunk
         ++ch_ref.use_count;
 
         data_buffer_t buffer = {};
-        buffer.data = &cache.chunks_buffer[ch_index * READ_CHUNK_SIZE];
+        buffer.data = src_data.mapped.data ?
+            const_cast<uint8_t*>(&src_data.mapped.data[size_t(req_src_offset)]) :
+            &cache.chunks_buffer[ch_index * READ_CHUNK_SIZE + ch_ref.data_shift];
         buffer.size = buf_size;
 
         res.index = ch_index;
@@ -198,27 +238,44 @@ chunk_request_result_t acquire_chunk(chunk_streaming_cache_t& cache, const chunk
     chunk_streaming_cache_t::chunk_t new_ch = {};
     new_ch.src = request.src;
     new_ch.src_offset = req_src_offset;
+    new_ch.data_shift = data_shift;
     new_ch.use_count = 1;
 
-    auto src_index = unpack(request.src);
-
-    const auto& src_data = cache.sources[src_index.index];
-    assert(src_data.generation == src_index.generation && "Accessing the source after deregister!");
-
     data_buffer_t buffer = {};
-    buffer.data = &cache.chunks_buffer[free_index * READ_CHUNK_SIZE];
     buffer.size = buf_size;
-    
-    // queue async chunk reading
-    async_read_request_t read_req = {};
-    read_req.file = src_data.file;
-    read_req.offset = req_src_offset;
-    read_req.out_buffer = buffer;
     new_ch.status = chunk_status_e::READING;
 
     chunk_streaming_cache_t::pending_read_t read_op = {};
-    read_op.read_token = request_read(cache.async_io, read_req);
     read_op.chunk_index = free_index;
+
+    if (src_data.mapped.data) {
+        assert(req_src_offset + buf_size <= src_data.mapped.size);
+
+        buffer.data = const_cast<uint8_t*>(&src_data.mapped.data[size_t(req_src_offset)]); // read only
+
+        // no copy, just make sure pages are resident before decoder touches them
+        const_data_buffer_t range = {};
+        range.data = buffer.data;
+        range.size = buffer.size;
+        read_op.read_token = request_prefetch(cache.async_io, range);
+    } else {
+        auto chunk_data = &cache.chunks_buffer[free_index * READ_CHUNK_SIZE];
+        buffer.data = chunk_data + data_shift;
+
+        // queue async chunk reading
+        async_read_request_t read_req = {};
+        read_req.file = src_data.file;
+        read_req.offset = req_src_offset;
+        read_req.out_buffer = buffer;
+        if (src_data.read_alignment) {
+            // whole aligned blocks around requested range, tail could go past file end
+            auto align_mask = src_data.read_alignment - 1;
+            read_req.offset = req_src_offset - data_shift;
+            read_req.out_buffer.data = chunk_data;
+            read_req.out_buffer.size = (data_shift + buf_size + align_mask) & ~size_t(align_mask);
+        }
+        read_op.read_token = request_read(cache.async_io, read_req);
+    }
     ++new_ch.use_count;
 
     assert(cache.pending_reads_count < std::size(cache.pending_reads));
@@ -16,8 +16,8 @@ enum streaming_source_handle : uint32_t;
 
 struct chunk_request_t {
     streaming_source_handle src;
-    range_t buffer_block;
-    uint32_t block_offset;
+    stream_range_t buffer_block;
+    uint64_t block_offset;
 };
 
 enum class chunk_status_e {
@@ -40,7 +40,17 @@ void destroy(chunk_streaming_cache_t* cache);
 
 void update_pending_reads(chunk_streaming_cache_t* cache);
 
-streaming_source_handle register_source(chunk_streaming_cache_t* cache, async_file_handle_t file);
+/**
+ * @brief register file source, read_alignment (power of 2 up to chunk size, 0 if none) makes reads
+ * start and end on aligned offsets, so aligned file layout gets only whole block reads
+ */
+streaming_source_handle register_source(chunk_streaming_cache_t* cache, async_file_handle_t file, uint32_t read_alignment = 0);
+
+/**
+ * @brief register memory mapped source, acquired chunks point directly into the mapping
+ * mapping should stay valid until deregister_source and all pending requests are processed
+ */
+streaming_source_handle register_mapped_source(chunk_streaming_cache_t* cache, const_data_buffer_t mapped);
 void deregister_source(chunk_streaming_cache_t* cache, streaming_source_handle src);
 
 chunk_request_result_t acquire_chunk(chunk_streaming_cache_t& cache, const chunk_request_t& request);
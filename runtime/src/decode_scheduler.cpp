@@ -0,0 +1,142 @@
+#include "decode_scheduler.h"
+
+#include "miniaudio_public.h" // ma_spinlock
+
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+#include "alloc_utils.inl"
+#include "jobs_utils.inl"
+
+namespace hle_audio {
+namespace rt {
+
+static const size_t MAX_DECODE_REQUESTS = 256;
+static const uint8_t MAX_DECODE_BATCHES = 8;
+static const uint8_t DEFAULT_DECODE_BATCHES = 2;
+
+struct decode_request_t {
+    hlea_job_t job;
+    uint32_t buffered_frames;
+};
+
+struct decode_batch_t {
+    hlea_job_t jobs[MAX_DECODE_REQUESTS];
+    uint16_t job_count;
+    std::atomic<bool> running;
+};
+
+struct decode_scheduler_t {
+    allocator_t allocator;
+    jobs_t jobs_sys;
+
+    ma_spinlock lock;
+    decode_request_t pending[MAX_DECODE_REQUESTS];
+    uint16_t pending_count;
+
+    // accessed by period thread only
+    decode_request_t sorted[MAX_DECODE_REQUESTS];
+
+    uint8_t batch_count;
+    decode_batch_t batches[MAX_DECODE_BATCHES];
+};
+
+decode_scheduler_t* create_decode_scheduler(const decode_scheduler_create_info_t& info) {
+    auto sched = allocate<decode_scheduler_t>(info.allocator);
+    new(sched) decode_scheduler_t(); // init c++ stuff
+    sched->allocator = info.allocator;
+    sched->jobs_sys = info.jobs;
+
+    auto batch_count = info.batch_count ? info.batch_count : DEFAULT_DECODE_BATCHES;
+    sched->batch_count = std::min(batch_count, MAX_DECODE_BATCHES);
+
+    return sched;
+}
+
+void destroy(decode_scheduler_t* sched) {
+    for (uint8_t i = 0; i < sched->batch_count; ++i) {
+        while (sched->batches[i].running) {
+            std::this_thread::yield();
+        }
+    }
+
+    sched->~decode_scheduler_t();
+    deallocate(sched->allocator, sched);
+}
+
+void schedule(decode_scheduler_t* sched, hlea_job_t job, uint32_t buffered_frames) {
+    ma_spinlock_lock(&sched->lock);
+
+    bool queued = sched->pending_count < MAX_DECODE_REQUESTS;
+    if (queued) {
+        auto& req = sched->pending[sched->pending_count++];
+        req.job = job;
+        req.buffered_frames = buffered_frames;
+    }
+
+    ma_spinlock_unlock(&sched->lock);
+
+    // too many voices, don't make them wait
+    if (!queued) launch(sched->jobs_sys, job);
+}
+
+static void decode_batch_jobfunc(void* udata) {
+    auto batch = (decode_batch_t*)udata;
+
+    for (uint16_t i = 0; i < batch->job_count; ++i) {
+        auto& job = batch->jobs[i];
+        job.job_func(job.udata);
+    }
+
+    batch->running = false;
+}
+
+void process_period(decode_scheduler_t* sched) {
+    // previous period batches could be still running, use only finished ones
+    decode_batch_t* free_batches[MAX_DECODE_BATCHES] = {};
+    uint8_t free_batch_count = 0;
+    for (uint8_t i = 0; i < sched->batch_count; ++i) {
+        if (!sched->batches[i].running) free_batches[free_batch_count++] = &sched->batches[i];
+    }
+    // keep requests pending till the next period
+    if (!free_batch_count) return;
+
+    ma_spinlock_lock(&sched->lock);
+    uint16_t request_count = sched->pending_count;
+    std::copy_n(sched->pending, request_count, sched->sorted);
+    sched->pending_count = 0;
+    ma_spinlock_unlock(&sched->lock);
+
+    if (!request_count) return;
+
+    // starving voices first
+    std::sort(sched->sorted, sched->sorted + request_count, 
+        [](const decode_request_t& a, const decode_request_t& b) {
+            return a.buffered_frames < b.buffered_frames;
+        });
+
+    // deal requests round robin, so batches are balanced and each starts with the most starving voices
+    uint8_t batch_count = uint8_t(std::min<uint16_t>(free_batch_count, request_count));
+    for (uint8_t i = 0; i < batch_count; ++i) {
+        free_batches[i]->job_count = 0;
+    }
+    for (uint16_t i = 0; i < request_count; ++i) {
+        auto batch = free_batches[i % batch_count];
+        batch->jobs[batch->job_count++] = sched->sorted[i].job;
+    }
+
+    for (uint8_t i = 0; i < batch_count; ++i) {
+        auto batch = free_batches[i];
+        batch->running = true;
+
+        hlea_job_t job = {};
+        job.job_func = decode_batch_jobfunc;
+        job.udata = batch;
+        launch(sched->jobs_sys, job);
+    }
+}
+
+}
+}
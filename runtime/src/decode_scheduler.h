@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include "internal_alloc_types.h"
+#include "internal_jobs_types.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * gathers decoding work of all voices and launches it as a few batch jobs once per audio period
+ */
+struct decode_scheduler_t;
+
+struct decode_scheduler_create_info_t {
+    allocator_t allocator;
+    jobs_t jobs;
+
+    // max jobs launched per period, ~worker threads count
+    uint8_t batch_count;
+};
+
+decode_scheduler_t* create_decode_scheduler(const decode_scheduler_create_info_t& info);
+
+/**
+ * waits for running batches, pending requests are dropped
+ */
+void destroy(decode_scheduler_t* sched);
+
+/**
+ * @brief queue decoding job till the next period
+ * @param buffered_frames decoded ahead frames of the voice, voices closer to starving are decoded first
+ */
+void schedule(decode_scheduler_t* sched, hlea_job_t job, uint32_t buffered_frames);
+
+/**
+ * launch queued jobs, called once per audio period
+ */
+void process_period(decode_scheduler_t* sched);
+
+}
+}
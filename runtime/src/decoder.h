@@ -1,10 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include "rt_types.h" // data_buffer_t
 
 namespace hle_audio {
 namespace rt {
 
+using decoder_stopped_func_t = void (*)(void* udata);
+
 struct decoder_ti {
     size_t (*release_consumed_inputs)(void* state);
     bool (*queue_input)(void* state, const data_buffer_t& buf, bool last_input);
@@ -15,6 +18,12 @@ struct decoder_ti {
      * @brief reset inputs and outputs
      */
     void (*flush)(void* state);
+
+    /**
+     * @brief flush and stop running job between frames, 
+     * stopped_func is called once decoder is idle, from the job thread or immediately if it's not running
+     */
+    void (*stop)(void* state, decoder_stopped_func_t stopped_func, void* udata);
 };
 
 struct decoder_t {
@@ -43,5 +52,56 @@ static void flush(decoder_t& dec) {
     dec.vt->flush(dec.state);
 }
 
+static void stop(decoder_t& dec, decoder_stopped_func_t stopped_func, void* udata) {
+    assert(dec.vt->stop);
+    dec.vt->stop(dec.state, stopped_func, udata);
+}
+
+/**
+ * decoding job running state with stop handshake,
+ * once stop is requested for running job, only the job notifies about it
+ */
+struct decoder_run_state_t {
+    enum : uint8_t {
+        IDLE = 0,
+        RUNNING,
+        STOPPING
+    };
+
+    std::atomic<uint8_t> state;
+    decoder_stopped_func_t stopped_func;
+    void* stopped_udata;
+};
+
+static bool is_running(const decoder_run_state_t& rs) {
+    return rs.state != decoder_run_state_t::IDLE;
+}
+
+static void start_running(decoder_run_state_t& rs) {
+    assert(!is_running(rs));
+    rs.state = decoder_run_state_t::RUNNING;
+}
+
+/**
+ * called by the job at the end, decoder could be reused right after stop notification
+ */
+static void finish_running(decoder_run_state_t& rs) {
+    if (rs.state.exchange(decoder_run_state_t::IDLE) == decoder_run_state_t::STOPPING) {
+        // owner waits for notification, so stop callback fields are still valid here
+        rs.stopped_func(rs.stopped_udata);
+    }
+}
+
+static void request_stop(decoder_run_state_t& rs, decoder_stopped_func_t stopped_func, void* udata) {
+    rs.stopped_func = stopped_func;
+    rs.stopped_udata = udata;
+
+    uint8_t expected = decoder_run_state_t::RUNNING;
+    if (!rs.state.compare_exchange_strong(expected, decoder_run_state_t::STOPPING)) {
+        // job is finished already
+        stopped_func(udata);
+    }
+}
+
 }
 }
@@ -0,0 +1,204 @@
+#include "decoder_adpcm.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "alloc_utils.inl"
+#include "internal/ima_adpcm.inl"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * @brief IMA ADPCM decoder
+ * decodes synchronously a block per output, no jobs involved.
+ * block split by inputs boundary is stitched
+ */
+
+static const size_t MAX_INPUT_BUFFERS = 2;
+static const size_t MAX_ADPCM_CHANNELS = IMA_MAX_CHANNELS;
+
+struct adpcm_decoder_t {
+    allocator_t allocator;
+    uint8_t channels;
+
+    data_buffer_t inputs[MAX_INPUT_BUFFERS];
+    uint8_t input_count;
+    uint8_t consumed_input_count;
+
+    size_t input_offset;
+
+    uint8_t stitch_buf[ADPCM_CHANNEL_BLOCK_BYTE_SIZE * MAX_ADPCM_CHANNELS];
+    uint32_t stitch_size;
+
+    int16_t pcm[ADPCM_SAMPLES_PER_BLOCK * MAX_ADPCM_CHANNELS];
+};
+
+static const data_buffer_t empty_data_buffer = {};
+
+adpcm_decoder_t* create_decoder(const adpcm_decoder_create_info_t& info) {
+    auto dec = allocate<adpcm_decoder_t>(info.allocator);
+    *dec = {};
+    dec->allocator = info.allocator;
+    reset(dec, info.channels);
+    return dec;
+}
+
+void destroy(adpcm_decoder_t* dec) {
+    deallocate(dec->allocator, dec);
+}
+
+void reset(adpcm_decoder_t* dec, uint8_t channels) {
+    assert(0 < channels && channels <= MAX_ADPCM_CHANNELS);
+
+    dec->channels = channels;
+    dec->input_count = 0;
+    dec->consumed_input_count = 0;
+    dec->input_offset = 0;
+    dec->stitch_size = 0;
+}
+
+static uint32_t block_byte_size(const adpcm_decoder_t* dec) {
+    return ADPCM_CHANNEL_BLOCK_BYTE_SIZE * dec->channels;
+}
+
+static data_buffer_t decode_block(adpcm_decoder_t* dec, const uint8_t* block) {
+    const uint32_t channels = dec->channels;
+    ima_decode_block(block, channels, ADPCM_CHANNEL_BLOCK_BYTE_SIZE, dec->pcm);
+
+    data_buffer_t res = {};
+    res.data = (uint8_t*)dec->pcm;
+    res.size = ADPCM_SAMPLES_PER_BLOCK * channels * sizeof(int16_t);
+    return res;
+}
+
+static size_t release_consumed_inputs(adpcm_decoder_t* dec) {
+    auto consumed_input_count = dec->consumed_input_count;
+
+    if (consumed_input_count) {
+        for (auto i = consumed_input_count; i < dec->input_count; ++i) {
+            dec->inputs[i - consumed_input_count] = dec->inputs[i];
+        }
+        dec->input_count -= consumed_input_count;
+        dec->consumed_input_count = 0;
+    }
+
+    return consumed_input_count;
+}
+
+static bool queue_input(adpcm_decoder_t* dec, const data_buffer_t& buf, bool /*last_input*/) {
+    if (dec->input_count == MAX_INPUT_BUFFERS) return false;
+
+    dec->inputs[dec->input_count++] = buf;
+
+    return true;
+}
+
+static void consume_input(adpcm_decoder_t* dec) {
+    dec->input_offset = 0;
+    ++dec->consumed_input_count;
+}
+
+static data_buffer_t next_output(adpcm_decoder_t* dec, const data_buffer_t& /*output_buf*/) {
+    // previous output is owned by decoder, nothing to release
+
+    const auto block_size = block_byte_size(dec);
+    while (dec->consumed_input_count < dec->input_count) {
+        auto& input = dec->inputs[dec->consumed_input_count];
+        auto rest_size = input.size - dec->input_offset;
+
+        // complete the block split by previous input
+        if (dec->stitch_size) {
+            auto copy_size = std::min(size_t(block_size - dec->stitch_size), rest_size);
+            memcpy(&dec->stitch_buf[dec->stitch_size], input.data + dec->input_offset, copy_size);
+            dec->stitch_size += uint32_t(copy_size);
+            dec->input_offset += copy_size;
+            if (dec->input_offset == input.size) consume_input(dec);
+
+            if (dec->stitch_size == block_size) {
+                dec->stitch_size = 0;
+                return decode_block(dec, dec->stitch_buf);
+            }
+            continue;
+        }
+
+        if (block_size <= rest_size) {
+            auto block = input.data + dec->input_offset;
+            dec->input_offset += block_size;
+            if (dec->input_offset == input.size) consume_input(dec);
+
+            return decode_block(dec, block);
+        }
+
+        memcpy(dec->stitch_buf, input.data + dec->input_offset, rest_size);
+        dec->stitch_size = uint32_t(rest_size);
+        consume_input(dec);
+    }
+
+    return empty_data_buffer;
+}
+
+static void flush(adpcm_decoder_t* dec) {
+    reset(dec, dec->channels);
+}
+
+//
+// decoder_ti vtable
+//
+
+static size_t adpcm_dec_release_consumed_inputs(void* state) {
+    auto dec = (adpcm_decoder_t*)state;
+    return release_consumed_inputs(dec);
+}
+
+static bool adpcm_dec_queue_input(void* state, const data_buffer_t& buf, bool last_input) {
+    auto dec = (adpcm_decoder_t*)state;
+    return queue_input(dec, buf, last_input);
+}
+
+static data_buffer_t adpcm_dec_next_output(void* state, const data_buffer_t& current_buf) {
+    auto dec = (adpcm_decoder_t*)state;
+    return next_output(dec, current_buf);
+}
+
+static bool adpcm_dec_is_running(void* /*state*/) {
+    // decoded synchronously
+    return false;
+}
+
+static void adpcm_dec_flush(void* state) {
+    auto dec = (adpcm_decoder_t*)state;
+    flush(dec);
+}
+
+static void adpcm_dec_stop(void* state, decoder_stopped_func_t stopped_func, void* udata) {
+    auto dec = (adpcm_decoder_t*)state;
+    flush(dec);
+
+    // synchronous, nothing to wait for
+    stopped_func(udata);
+}
+
+constexpr decoder_ti init_adpcm_decoder_vt() {
+    decoder_ti vt = {};
+    vt.release_consumed_inputs = adpcm_dec_release_consumed_inputs;
+    vt.queue_input = adpcm_dec_queue_input;
+    vt.next_output = adpcm_dec_next_output;
+    vt.is_running = adpcm_dec_is_running;
+    vt.flush = adpcm_dec_flush;
+    vt.stop = adpcm_dec_stop;
+
+    return vt;
+}
+
+static const decoder_ti g_adpcm_decoder_vt = init_adpcm_decoder_vt();
+
+decoder_t cast_to_decoder(adpcm_decoder_t* dec) {
+    decoder_t res = {};
+    res.vt = &g_adpcm_decoder_vt;
+    res.state = dec;
+    return res;
+}
+
+}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "decoder.h"
+#include "internal_alloc_types.h"
+
+namespace hle_audio {
+namespace rt {
+
+struct adpcm_decoder_t;
+
+struct adpcm_decoder_create_info_t {
+    allocator_t allocator;
+    uint8_t channels;
+};
+
+adpcm_decoder_t* create_decoder(const adpcm_decoder_create_info_t& info);
+void destroy(adpcm_decoder_t* dec);
+
+void reset(adpcm_decoder_t* dec, uint8_t channels);
+decoder_t cast_to_decoder(adpcm_decoder_t* dec);
+
+}
+}
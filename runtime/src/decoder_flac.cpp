@@ -0,0 +1,404 @@
+#include "decoder_flac.h"
+
+#include "rt_types.h"
+#include "hlea/runtime.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#include "alloc_utils.inl"
+#include "ring_indices.inl"
+
+/**
+ * dr_flac is compiled within miniaudio implementation (ma_impl.c),
+ * its declarations are part of miniaudio implementation section, so only used subset is declared here
+ */
+extern "C" {
+    typedef struct drflac drflac;
+    typedef uint32_t drflac_bool32;
+    typedef enum {
+        drflac_seek_origin_start,
+        drflac_seek_origin_current
+    } drflac_seek_origin;
+
+    typedef size_t (* drflac_read_proc)(void* pUserData, void* pBufferOut, size_t bytesToRead);
+    typedef drflac_bool32 (* drflac_seek_proc)(void* pUserData, int offset, drflac_seek_origin origin);
+
+    drflac* drflac_open(drflac_read_proc onRead, drflac_seek_proc onSeek, void* pUserData, const void* pAllocationCallbacks);
+    void drflac_close(drflac* pFlac);
+    uint64_t drflac_read_pcm_frames_f32(drflac* pFlac, uint64_t framesToRead, float* pBufferOut);
+}
+
+namespace hle_audio {
+namespace rt {
+
+static const size_t MAX_FLAC_INPUT_BUFFERS = 2;
+static const size_t MAX_FLAC_OUTPUT_BUFFERS = 4;
+
+// interleaved samples per output buffer (1024 stereo frames)
+static const size_t FLAC_OUTPUT_SAMPLES = 2048;
+
+/**
+ * dr_flac pulls data and can't resume a frame on data shortage,
+ * so decoding goes on only while queued inputs have more than the biggest expected frame
+ */
+static const size_t MIN_FLAC_DECODE_BYTES = 32768;
+
+struct flac_output_buffer_t {
+    float pcm[FLAC_OUTPUT_SAMPLES];
+    int frame_count;
+};
+
+struct flac_input_buffer_t {
+    data_buffer_t buffer;
+    bool last;
+};
+
+struct flac_decoder_t {
+    allocator_t allocator;
+    decode_scheduler_t* scheduler;
+    uint8_t channels;
+
+    // job reads inputs [0, job_state.input_count) while running, new inputs are appended only
+    flac_input_buffer_t inputs[MAX_FLAC_INPUT_BUFFERS];
+    uint8_t input_count;
+
+    bool reset_state;
+
+    struct job_state_t {
+        // todo: dr_flac allocates with malloc, consider passing allocation callbacks over allocator_t
+        drflac* flac;
+        bool finished;
+        bool has_last_input;
+
+        uint8_t input_count;
+        uint8_t consumed_input_count;
+        size_t read_offset;
+
+        flac_output_buffer_t outputs[MAX_FLAC_OUTPUT_BUFFERS];
+        ring_indices<uint8_t, MAX_FLAC_OUTPUT_BUFFERS> output_indices;
+        decoder_run_state_t run_state;
+        std::atomic<bool> stop_requested;
+    } job_state;
+};
+
+static void close_flac(flac_decoder_t::job_state_t* state) {
+    if (state->flac) {
+        drflac_close(state->flac);
+        state->flac = nullptr;
+    }
+}
+
+flac_decoder_t* create_decoder(const flac_decoder_create_info_t& info) {
+    auto dec = allocate<flac_decoder_t>(info.allocator);
+    new(dec) flac_decoder_t(); // init c++ stuff
+    dec->allocator = info.allocator;
+    dec->scheduler = info.scheduler;
+    dec->channels = info.channels;
+
+    return dec;
+}
+
+void destroy(flac_decoder_t* dec) {
+    close_flac(&dec->job_state);
+
+    dec->~flac_decoder_t();
+    deallocate(dec->allocator, dec);
+}
+
+void reset(flac_decoder_t* dec, uint8_t channels) {
+    auto alloc = dec->allocator;
+    auto scheduler = dec->scheduler;
+
+    close_flac(&dec->job_state);
+
+    // destroy + create witout allocation
+    dec->~flac_decoder_t();
+    new(dec) flac_decoder_t(); // init c++ stuff
+    dec->allocator = alloc;
+    dec->scheduler = scheduler;
+    dec->channels = channels;
+}
+
+//---------------------------------------------------------------------------------------
+// job
+
+static size_t available_input_bytes(const flac_decoder_t* dec) {
+    auto& state = dec->job_state;
+
+    size_t res = 0;
+    for (auto i = state.consumed_input_count; i < state.input_count; ++i) {
+        res += dec->inputs[i].buffer.size;
+    }
+    return res - state.read_offset;
+}
+
+static bool can_decode(const flac_decoder_t* dec) {
+    return dec->job_state.has_last_input || MIN_FLAC_DECODE_BYTES <= available_input_bytes(dec);
+}
+
+static size_t skip_input_bytes(flac_decoder_t* dec, void* out, size_t size) {
+    auto& state = dec->job_state;
+    auto out_ptr = (uint8_t*)out;
+
+    size_t res = 0;
+    while (size && state.consumed_input_count < state.input_count) {
+        auto& input = dec->inputs[state.consumed_input_count].buffer;
+        auto avail = input.size - state.read_offset;
+        auto read_size = size < avail ? size : avail;
+
+        if (out_ptr) {
+            memcpy(out_ptr + res, input.data + state.read_offset, read_size);
+        }
+        state.read_offset += read_size;
+        res += read_size;
+        size -= read_size;
+
+        if (state.read_offset == input.size) {
+            state.read_offset = 0;
+            ++state.consumed_input_count;
+        }
+    }
+
+    return res;
+}
+
+static size_t flac_read(void* udata, void* out, size_t size) {
+    auto dec = (flac_decoder_t*)udata;
+    return skip_input_bytes(dec, out, size);
+}
+
+static drflac_bool32 flac_seek(void* udata, int offset, drflac_seek_origin origin) {
+    auto dec = (flac_decoder_t*)udata;
+
+    // only forward skips are possible with pushed inputs (metadata blocks)
+    if (origin != drflac_seek_origin_current || offset < 0) return 0;
+
+    return skip_input_bytes(dec, nullptr, size_t(offset)) == size_t(offset);
+}
+
+static void decode_flac(flac_decoder_t* dec) {
+    auto& state = dec->job_state;
+
+    while (!state.finished && state.output_indices.can_write()) {
+        // flushed or stopped, drop the rest
+        if (state.stop_requested) break;
+
+        if (!can_decode(dec)) break;
+
+        if (!state.flac) {
+            state.flac = drflac_open(flac_read, flac_seek, dec, nullptr);
+            if (!state.flac) {
+                // broken stream, drop the rest
+                skip_input_bytes(dec, nullptr, available_input_bytes(dec));
+                state.finished = true;
+                break;
+            }
+        }
+
+        auto wp = state.output_indices.write_pos.load();
+        auto& output = state.outputs[wp & (MAX_FLAC_OUTPUT_BUFFERS - 1)];
+
+        auto frame_count = drflac_read_pcm_frames_f32(state.flac, FLAC_OUTPUT_SAMPLES / dec->channels, output.pcm);
+        if (frame_count == 0) {
+            // end of stream, drop trailing data
+            skip_input_bytes(dec, nullptr, available_input_bytes(dec));
+            state.finished = true;
+            break;
+        }
+        output.frame_count = int(frame_count);
+
+        state.output_indices.write_pos.store(++wp);
+    }
+
+    finish_running(state.run_state);
+}
+
+static void decode_flac_jobfunc(void* udata) {
+    auto dec = (flac_decoder_t*)udata;
+    decode_flac(dec);
+}
+
+// job
+//---------------------------------------------------------------------------------------
+
+static size_t release_consumed_inputs(flac_decoder_t* dec) {
+    // flushed inputs are gone, counter is dropped on reset
+    if (is_running(dec->job_state.run_state) || dec->reset_state) return 0;
+
+    auto consumed_input_count = dec->job_state.consumed_input_count;
+
+    if (consumed_input_count) {
+        assert(consumed_input_count <= dec->input_count);
+        for (auto i = consumed_input_count; i < dec->input_count; ++i) {
+            dec->inputs[i - consumed_input_count] = dec->inputs[i];
+        }
+        dec->input_count -= consumed_input_count;
+        dec->job_state.input_count -= consumed_input_count;
+        dec->job_state.consumed_input_count = 0;
+    }
+
+    return consumed_input_count;
+}
+
+static void reset_inputs(flac_decoder_t::job_state_t* state) {
+    state->output_indices.reset();
+    state->stop_requested = false;
+    state->input_count = 0;
+    state->consumed_input_count = 0;
+    state->read_offset = 0;
+    state->finished = false;
+    state->has_last_input = false;
+
+    // inputs are queued from the stream start again
+    close_flac(state);
+}
+
+static void kick_decoding_job(flac_decoder_t* dec) {
+    auto& state = dec->job_state;
+    if (is_running(state.run_state)) return;
+
+    if (dec->reset_state) {
+        dec->reset_state = false;
+        reset_inputs(&state);
+    }
+
+    if (state.finished) return;
+
+    // expose queued inputs to the job
+    state.input_count = dec->input_count;
+    for (uint8_t i = 0; i < state.input_count; ++i) {
+        state.has_last_input |= dec->inputs[i].last;
+    }
+
+    if (!can_decode(dec)) return;
+
+    if (!state.output_indices.can_write()) return;
+
+    // launch decoder job
+    start_running(state.run_state);
+
+    hlea_job_t job  = {};
+    job.job_func = decode_flac_jobfunc;
+    job.udata = dec;
+    schedule(dec->scheduler, job, state.output_indices.used_count() * FLAC_OUTPUT_SAMPLES);
+}
+
+static bool queue_input(flac_decoder_t* dec, const data_buffer_t& buf, bool last_input) {
+    if (dec->input_count == MAX_FLAC_INPUT_BUFFERS) return false;
+
+    flac_input_buffer_t input = {};
+    input.buffer = buf;
+    input.last = last_input;
+    dec->inputs[dec->input_count++] = input;
+
+    kick_decoding_job(dec);
+
+    return true;
+}
+
+static void release_output(flac_decoder_t* dec, data_buffer_t output_buf) {
+    if (output_buf.size) {
+        auto rp = dec->job_state.output_indices.read_pos.load();
+        dec->job_state.output_indices.read_pos.store(++rp);
+
+        // we now have one vacant output buffer to decode into
+        kick_decoding_job(dec);
+    }
+}
+
+static data_buffer_t next_output(flac_decoder_t* dec, const data_buffer_t& current_buf) {
+    // release previous buffer
+    release_output(dec, current_buf);
+
+    auto rp = dec->job_state.output_indices.read_pos.load();
+
+    // return empty if next is still writing
+    auto wp = dec->job_state.output_indices.write_pos.load();
+    if (rp == wp) {
+        return {};
+    }
+
+    auto& output = dec->job_state.outputs[rp & (MAX_FLAC_OUTPUT_BUFFERS - 1)];
+
+    data_buffer_t res = {};
+    res.data = (uint8_t*)output.pcm;
+    res.size = output.frame_count * dec->channels * sizeof(float);
+    return res;
+}
+
+static bool is_running(const flac_decoder_t* dec) {
+    return is_running(dec->job_state.run_state);
+}
+
+static void flush(flac_decoder_t* dec) {
+    if (is_running(dec->job_state.run_state)) {
+        dec->job_state.stop_requested = true;
+    }
+    dec->reset_state = true;
+    dec->input_count = 0;
+}
+
+static void stop(flac_decoder_t* dec, decoder_stopped_func_t stopped_func, void* udata) {
+    flush(dec);
+    request_stop(dec->job_state.run_state, stopped_func, udata);
+}
+
+//
+// decoder_ti vtable
+//
+
+static size_t flacdec_release_consumed_inputs(void* state) {
+    auto dec = (flac_decoder_t*)state;
+    return release_consumed_inputs(dec);
+}
+
+static bool flacdec_queue_input(void* state, const data_buffer_t& buf, bool last_input) {
+    auto dec = (flac_decoder_t*)state;
+    return queue_input(dec, buf, last_input);
+}
+
+static data_buffer_t flacdec_next_output(void* state, const data_buffer_t& current_buf) {
+    auto dec = (flac_decoder_t*)state;
+    return next_output(dec, current_buf);
+}
+
+static bool flacdec_is_running(void* state) {
+    auto dec = (flac_decoder_t*)state;
+    return is_running(dec);
+}
+
+static void flacdec_flush(void* state) {
+    auto dec = (flac_decoder_t*)state;
+    flush(dec);
+}
+
+static void flacdec_stop(void* state, decoder_stopped_func_t stopped_func, void* udata) {
+    auto dec = (flac_decoder_t*)state;
+    stop(dec, stopped_func, udata);
+}
+
+constexpr decoder_ti init_flac_decoder_vt() {
+    decoder_ti vt = {};
+    vt.release_consumed_inputs = flacdec_release_consumed_inputs;
+    vt.queue_input = flacdec_queue_input;
+    vt.next_output = flacdec_next_output;
+    vt.is_running = flacdec_is_running;
+    vt.flush = flacdec_flush;
+    vt.stop = flacdec_stop;
+
+    return vt;
+}
+
+static const decoder_ti g_flac_decoder_vt = init_flac_decoder_vt();
+
+decoder_t cast_to_decoder(flac_decoder_t* dec) {
+    decoder_t res = {};
+    res.vt = &g_flac_decoder_vt;
+    res.state = dec;
+    return res;
+}
+
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "decoder.h"
+#include "internal_alloc_types.h"
+#include "decode_scheduler.h"
+
+namespace hle_audio {
+namespace rt {
+
+struct flac_decoder_t;
+
+struct flac_decoder_create_info_t {
+    allocator_t allocator;
+    decode_scheduler_t* scheduler;
+    uint8_t channels;
+};
+
+flac_decoder_t* create_decoder(const flac_decoder_create_info_t& info);
+void destroy(flac_decoder_t* dec);
+
+void reset(flac_decoder_t* dec, uint8_t channels);
+decoder_t cast_to_decoder(flac_decoder_t* dec);
+
+}
+}
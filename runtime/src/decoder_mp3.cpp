@@ -11,19 +11,24 @@
 #include <atomic>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 
-#include "jobs_utils.inl"
 #include "alloc_utils.inl"
+#include "ring_indices.inl"
+#include "internal/memory_utils.inl"
 
 namespace hle_audio {
 namespace rt {
 
 static const size_t MAX_INPUT_BUFFERS = 2;
-static const size_t MAX_OUTPUT_BUFFERS = 4;
+static const uint32_t MIN_OUTPUT_BUFFERS = 4;
+static const uint32_t MAX_OUTPUT_BUFFERS = 1024;
+
+// ring is sized for the highest common sample rate
+static const uint32_t OUTPUT_RING_SAMPLE_RATE = 48000;
+static const uint32_t MAX_FRAME_SAMPLES = 1152;
 
 struct output_buffer_t {
-    float pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
-    int frame_offset;
     int frame_count;
     int channels;
 };
@@ -33,30 +38,13 @@ struct input_buffer_t {
     bool last;
 };
 
-template<typename T, size_t ring_indices_range>
-struct ring_indices {
-    using indices_type = T;
-    static const size_t range_size = ring_indices_range;
-
-    std::atomic<indices_type> read_pos;
-    std::atomic<indices_type> write_pos;
-
-    void reset() {
-        read_pos = write_pos = {};
-    }
-
-    bool can_write() const {
-        return write_pos.load() != indices_type(read_pos.load() + range_size);
-    }
-};
-
 // ~10 mp3 frames
 static const size_t MIN_DATA_CHUNK_SIZE = 16384;
 
 struct mp3_decoder_t {
     // todo: consider moving these upper level refs to specific function context parameters
     allocator_t allocator;
-    jobs_t jobs_sys;
+    decode_scheduler_t* scheduler;
 
     input_buffer_t inputs[MAX_INPUT_BUFFERS];
     uint8_t input_count;
@@ -70,43 +58,138 @@ struct mp3_decoder_t {
         input_buffer_t input;
         bool not_enough_input_data;
 
-        uint8_t aux_input_buf[MIN_DATA_CHUNK_SIZE];
+        // acquired from shared pool only while frame straddles inputs boundary
+        scratch_pool_t* aux_pool;
+        uint8_t* aux_input_buf;
         size_t aux_input_size;
         data_buffer_t aux_input;
 
-        output_buffer_t outputs[MAX_OUTPUT_BUFFERS];
-        ring_indices<uint8_t, MAX_OUTPUT_BUFFERS> output_indices;
-        std::atomic<bool> running;
+        /**
+         * output ring, frame per buffer, pcm of buffers is contiguous,
+         * so successive full buffers are handed out as a single span
+         */
+        output_buffer_t* outputs;
+        uint8_t* outputs_pcm;
+        uint8_t sample_byte_size;
+        sized_ring_indices<uint16_t> output_indices;
+        decoder_run_state_t run_state;
         std::atomic<bool> stop_requested;
     } job_state;
+
+    // output buffers count handed out with the last next_output
+    uint16_t output_span_count;
 };
 
+static uint32_t get_output_buffers_count(uint32_t ring_ms) {
+    uint32_t frames = (ring_ms * OUTPUT_RING_SAMPLE_RATE / 1000 + MAX_FRAME_SAMPLES - 1) / MAX_FRAME_SAMPLES;
+
+    uint32_t res = MIN_OUTPUT_BUFFERS;
+    while (res < frames && res < MAX_OUTPUT_BUFFERS) res <<= 1;
+    return res;
+}
+
+struct mp3_decoder_layout_t {
+    uint32_t output_count;
+    size_t outputs_offset;
+    size_t pcm_offset;
+    size_t size;
+};
+
+// single allocation: decoder | outputs | outputs pcm
+static mp3_decoder_layout_t get_layout(const mp3_decoder_create_info_t& info) {
+    mp3_decoder_layout_t res = {};
+    res.output_count = get_output_buffers_count(info.output_ring_ms);
+
+    size_t sample_byte_size = info.s16_output ? sizeof(int16_t) : sizeof(float);
+    res.outputs_offset = align_forward(sizeof(mp3_decoder_t), alignof(output_buffer_t));
+    res.pcm_offset = align_forward(res.outputs_offset + res.output_count * sizeof(output_buffer_t), alignof(float));
+    res.size = res.pcm_offset + res.output_count * MINIMP3_MAX_SAMPLES_PER_FRAME * sample_byte_size;
+    return res;
+}
+
+size_t get_decoder_memory_size(const mp3_decoder_create_info_t& info) {
+    return get_layout(info).size;
+}
+
+/**
+ * keep setup over reset
+ */
+struct mp3_decoder_setup_t {
+    allocator_t allocator;
+    decode_scheduler_t* scheduler;
+    scratch_pool_t* aux_pool;
+    output_buffer_t* outputs;
+    uint8_t* outputs_pcm;
+    uint8_t sample_byte_size;
+    uint16_t output_count;
+};
+
+static void apply_setup(mp3_decoder_t* dec, const mp3_decoder_setup_t& setup) {
+    dec->allocator = setup.allocator;
+    dec->scheduler = setup.scheduler;
+    dec->job_state.aux_pool = setup.aux_pool;
+    dec->job_state.outputs = setup.outputs;
+    dec->job_state.outputs_pcm = setup.outputs_pcm;
+    dec->job_state.sample_byte_size = setup.sample_byte_size;
+    dec->job_state.output_indices.range_size = setup.output_count;
+}
+
 mp3_decoder_t* create_decoder(const mp3_decoder_create_info_t& info) {
-    auto dec = allocate<mp3_decoder_t>(info.allocator);
+    assert(info.aux_pool && MIN_DATA_CHUNK_SIZE <= get_block_size(info.aux_pool));
+
+    auto layout = get_layout(info);
+
+    auto mem = (uint8_t*)allocate(info.allocator, layout.size, alignof(mp3_decoder_t));
+    auto dec = (mp3_decoder_t*)mem;
     new(dec) mp3_decoder_t(); // init c++ stuff
-    dec->allocator = info.allocator;
-    dec->jobs_sys = info.jobs;
+
+    mp3_decoder_setup_t setup = {};
+    setup.allocator = info.allocator;
+    setup.scheduler = info.scheduler;
+    setup.aux_pool = info.aux_pool;
+    setup.outputs = (output_buffer_t*)(mem + layout.outputs_offset);
+    setup.outputs_pcm = mem + layout.pcm_offset;
+    setup.sample_byte_size = info.s16_output ? sizeof(int16_t) : sizeof(float);
+    setup.output_count = uint16_t(layout.output_count);
+    apply_setup(dec, setup);
 
     mp3dec_init(&dec->job_state.mp3d);
     
     return dec;
 }
 
+static void release_aux(mp3_decoder_t::job_state_t* state) {
+    if (state->aux_input_buf) {
+        release_block(state->aux_pool, state->aux_input_buf);
+        state->aux_input_buf = nullptr;
+    }
+    state->aux_input_size = 0;
+    state->aux_input = {};
+}
+
 void destroy(mp3_decoder_t* dec) {
+    release_aux(&dec->job_state);
+
     dec->~mp3_decoder_t();
     deallocate(dec->allocator, dec);
 }
 
 void reset(mp3_decoder_t* dec) {
-    auto alloc = dec->allocator;
-    auto jobs = dec->jobs_sys;
+    release_aux(&dec->job_state);
+
+    mp3_decoder_setup_t setup = {};
+    setup.allocator = dec->allocator;
+    setup.scheduler = dec->scheduler;
+    setup.aux_pool = dec->job_state.aux_pool;
+    setup.outputs = dec->job_state.outputs;
+    setup.outputs_pcm = dec->job_state.outputs_pcm;
+    setup.sample_byte_size = dec->job_state.sample_byte_size;
+    setup.output_count = dec->job_state.output_indices.range_size;
 
     // destroy + create witout allocation
-    // todo: fix duplication | use destroy -> create_decoder on upper level, too heavy?
     dec->~mp3_decoder_t();
     new(dec) mp3_decoder_t(); // init c++ stuff
-    dec->allocator = alloc;
-    dec->jobs_sys = jobs;
+    apply_setup(dec, setup);
 
     mp3dec_init(&dec->job_state.mp3d);
 }
@@ -114,13 +197,30 @@ void reset(mp3_decoder_t* dec) {
 //---------------------------------------------------------------------------------------
 // job
 
+static int get_frame_samples(const mp3dec_frame_info_t& info) {
+    if (info.layer == 1) return 384;
+    // MPEG2 and MPEG2.5 layer 3 frames are half sized
+    if (info.layer == 3 && info.hz < 32000) return 576;
+    return 1152;
+}
+
+static uint8_t* get_output_pcm(const mp3_decoder_t::job_state_t* state, uint32_t output_index) {
+    return state->outputs_pcm + output_index * MINIMP3_MAX_SAMPLES_PER_FRAME * state->sample_byte_size;
+}
+
 static void consume_rest_input(mp3_decoder_t::job_state_t* state) {
     // keep the rest part of input
     if (0 < state->input.buffer.size) {
-        assert(state->input.buffer.size <= sizeof(state->aux_input_buf));
+        assert(state->input.buffer.size <= MIN_DATA_CHUNK_SIZE);
 
-        memcpy(state->aux_input_buf, state->input.buffer.data, state->input.buffer.size);
-        state->aux_input_size = state->input.buffer.size;
+        if (!state->aux_input_buf) {
+            state->aux_input_buf = acquire_block(state->aux_pool);
+        }
+        // out of memory, frame is lost, decoder resyncs on the next one
+        if (state->aux_input_buf) {
+            memcpy(state->aux_input_buf, state->input.buffer.data, state->input.buffer.size);
+            state->aux_input_size = state->input.buffer.size;
+        }
     }
 
     state->input = {};
@@ -155,6 +255,9 @@ static void decode_mp3(mp3_decoder_t::job_state_t* state) {
     }
     
     while(state->output_indices.can_write()) {
+        // flushed or stopped, drop the rest
+        if (state->stop_requested) break;
+
 
         if (is_empty(state->input.buffer)) {
             consume_rest_input(state);
@@ -164,31 +267,51 @@ static void decode_mp3(mp3_decoder_t::job_state_t* state) {
         auto input_ptr = state->aux_input.data ? &state->aux_input : &state->input.buffer;
 
         auto wp = state->output_indices.write_pos.load();
-        auto& output = state->outputs[wp & (MAX_OUTPUT_BUFFERS - 1)];
+        auto output_index = wp & (state->output_indices.range_size - 1);
+        auto& output = state->outputs[output_index];
+        auto output_pcm = get_output_pcm(state, output_index);
+
+        // s16 output is converted from per thread scratch frame
+        static thread_local float s_frame_pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+        bool s16_output = state->sample_byte_size == sizeof(int16_t);
+        float* frame_pcm = s16_output ? s_frame_pcm : (float*)output_pcm;
 
-        mp3dec_frame_info_t info;
-        output.frame_offset = 0;
-        output.frame_count = mp3dec_decode_frame(&state->mp3d, input_ptr->data, input_ptr->size, output.pcm, &info);
+        mp3dec_frame_info_t info = {};
+        output.frame_count = mp3dec_decode_frame(&state->mp3d, input_ptr->data, input_ptr->size, frame_pcm, &info);
         output.channels = info.channels;
 
-        // Insufficient data
-        assert(output.frame_count);
+        bool has_output = true;
+        if (!output.frame_count) {
+            if (info.hz) {
+                // valid frame without enough bit reservoir data (decoding started from seek point),
+                // output silence to keep frames to samples mapping
+                output.frame_count = get_frame_samples(info);
+                memset(output_pcm, 0, state->sample_byte_size * output.frame_count * output.channels);
+            } else {
+                // no frame, skip garbage (tags, etc.)
+                has_output = false;
+                if (!info.frame_bytes) info.frame_bytes = int(input_ptr->size);
+            }
+        } else if (s16_output) {
+            mp3dec_f32_to_s16(frame_pcm, (int16_t*)output_pcm, output.frame_count * output.channels);
+        }
 
         *input_ptr = advance(*input_ptr, info.frame_bytes);
         if (state->aux_input.data) {
-            auto aux_processed_bytes = state->aux_input.data - state->aux_input_buf;
+            auto aux_processed_bytes = size_t(state->aux_input.data - state->aux_input_buf);
             // use current input when processed aux buffer from previous input
             if (state->aux_input_size <= aux_processed_bytes) {
                 // advance input with bytes 
                 state->input.buffer = advance(state->input.buffer, aux_processed_bytes - state->aux_input_size);
 
                 // reset aux buffer
-                state->aux_input_size = 0;
-                state->aux_input = {};
+                release_aux(state);
             }
         }
 
-        state->output_indices.write_pos.store(++wp);
+        if (has_output) {
+            state->output_indices.write_pos.store(++wp);
+        }
 
         // consume input if less than 5 mp3 frames data left
         if (is_empty(state->input.buffer) ||
@@ -200,7 +323,7 @@ static void decode_mp3(mp3_decoder_t::job_state_t* state) {
     }
 
     // we could've been here when out_read_pos is increased from the poll thread (output_indices.read_pos.store++)
-    state->running = false;
+    finish_running(state->run_state);
 }
 
 static void decode_mp3_jobfunc(void* udata) {
@@ -212,7 +335,8 @@ static void decode_mp3_jobfunc(void* udata) {
 //---------------------------------------------------------------------------------------
 
 static size_t release_consumed_inputs(mp3_decoder_t* dec) {
-    if (!dec->job_state.running) {
+    // flushed inputs are gone, flag is dropped on reset
+    if (!is_running(dec->job_state.run_state) && !dec->reset_state) {
         if (dec->job_state.not_enough_input_data) {
             dec->job_state.not_enough_input_data = false;
 
@@ -237,11 +361,11 @@ static size_t release_consumed_inputs(mp3_decoder_t* dec) {
 
 static void reset_inputs(mp3_decoder_t::job_state_t* state) {
     state->output_indices.reset();
+    state->stop_requested = false;
     state->input = {};
 
     // reset aux buffer
-    state->aux_input_size = 0;
-    state->aux_input = {};
+    release_aux(state);
 
     state->not_enough_input_data = false;
 
@@ -249,7 +373,7 @@ static void reset_inputs(mp3_decoder_t::job_state_t* state) {
 }
 
 static void kick_decoding_job(mp3_decoder_t* dec) {
-    if (dec->job_state.running) return;
+    if (is_running(dec->job_state.run_state)) return;
 
     if (dec->reset_state) {
         dec->reset_state = false;
@@ -266,8 +390,9 @@ static void kick_decoding_job(mp3_decoder_t* dec) {
     bool has_inputs = dec->consumed_input_count < dec->input_count;
     if (!has_inputs) return;
 
-    // or outputs
-    if (!dec->job_state.output_indices.can_write()) return;
+    // or enough outputs, a job fills at least half of the ring
+    auto& output_indices = dec->job_state.output_indices;
+    if (output_indices.range_size / 2 < output_indices.used_count()) return;
 
     if (is_empty(dec->job_state.input.buffer)) {
         dec->job_state.input = dec->inputs[dec->consumed_input_count];
@@ -276,12 +401,12 @@ static void kick_decoding_job(mp3_decoder_t* dec) {
     assert(dec->job_state.input.buffer.size);
 
     // launch decoder job
-    dec->job_state.running = true;
+    start_running(dec->job_state.run_state);
 
     hlea_job_t job  = {};
     job.job_func = decode_mp3_jobfunc;
     job.udata = &dec->job_state;
-    launch(dec->jobs_sys, job);
+    schedule(dec->scheduler, job, dec->job_state.output_indices.used_count() * MAX_FRAME_SAMPLES);
 }
 
 static bool queue_input(mp3_decoder_t* state, const data_buffer_t& buf, bool last_input) {
@@ -299,61 +424,72 @@ static bool queue_input(mp3_decoder_t* state, const data_buffer_t& buf, bool las
     return true;
 }
 
-static bool contains(const output_buffer_t& out_buf, const void* ptr) {
-    auto ptr_u8 = (uint8_t*)ptr;
-    return (uint8_t*)out_buf.pcm <= ptr_u8 && ptr_u8 < ((uint8_t*)out_buf.pcm + sizeof(out_buf.pcm));
-}
-
 static void release_output(mp3_decoder_t* dec, data_buffer_t output_buf) {
     if (output_buf.size) {
+        assert(dec->output_span_count);
+
         auto rp = dec->job_state.output_indices.read_pos.load();
-        assert(contains(dec->job_state.outputs[(rp & MAX_OUTPUT_BUFFERS - 1)], output_buf.data));
-        
-        dec->job_state.output_indices.read_pos.store(++rp);
+        assert(get_output_pcm(&dec->job_state, rp & (dec->job_state.output_indices.range_size - 1)) == output_buf.data);
+
+        dec->job_state.output_indices.read_pos.store(rp + dec->output_span_count);
+        dec->output_span_count = 0;
 
-        // we now have one vacant output buffer to decode into
+        // we now have vacant output buffers to decode into
         // todo: here it is possible to get into condition where job is almost finished, but running flag is still true
         // launch decoding job
         kick_decoding_job(dec);
     }
 }
 
-static data_buffer_t get_frames_output_buffer(const output_buffer_t& output) {
-    assert(output.frame_offset < output.frame_count);
-
-    auto sample_byte_size = sizeof(float) * output.channels;
-
-    data_buffer_t res = {};
-    res.data = (uint8_t*)output.pcm + output.frame_offset * sample_byte_size;
-    res.size = (output.frame_count - output.frame_offset) * sample_byte_size;
-    return res;
-}
-
 static data_buffer_t next_output(mp3_decoder_t* dec, const data_buffer_t& current_buf) {
-    
+    auto& state = dec->job_state;
 
     // release previous buffer
     release_output(dec, current_buf);
 
-    auto rp = dec->job_state.output_indices.read_pos.load();
+    auto rp = state.output_indices.read_pos.load();
     
     // return empty if next is still writing
-    auto wp = dec->job_state.output_indices.write_pos.load();
+    auto wp = state.output_indices.write_pos.load();
     if (rp == wp) {
         return {};
     }
 
-    uint8_t read_buf_index = rp & (MAX_OUTPUT_BUFFERS - 1);
+    const uint16_t index_mask = state.output_indices.range_size - 1;
+    uint16_t first_index = rp & index_mask;
+    auto& first_output = state.outputs[first_index];
+    auto sample_byte_size = state.sample_byte_size * first_output.channels;
 
-    return get_frames_output_buffer(dec->job_state.outputs[read_buf_index]);
+    data_buffer_t res = {};
+    res.data = get_output_pcm(&state, first_index);
+    res.size = first_output.frame_count * sample_byte_size;
+
+    // merge successive ready buffers while they are contiguous in memory (previous one is full)
+    uint16_t span_count = 1;
+    auto prev_output = &first_output;
+    while (uint16_t(rp + span_count) != wp) {
+        uint16_t index = first_index + span_count;
+        bool prev_full = prev_output->frame_count * prev_output->channels == MINIMP3_MAX_SAMPLES_PER_FRAME;
+        if (index_mask < index || !prev_full) break;
+
+        auto& output = state.outputs[index];
+        if (output.channels != first_output.channels) break;
+
+        res.size += output.frame_count * sample_byte_size;
+        prev_output = &output;
+        ++span_count;
+    }
+    dec->output_span_count = span_count;
+
+    return res;
 }
 
 static bool is_running(const mp3_decoder_t* dec) {
-    return dec->job_state.running;
+    return is_running(dec->job_state.run_state);
 }
 
 static void flush(mp3_decoder_t* dec) {
-    if (dec->job_state.running) {
+    if (is_running(dec->job_state.run_state)) {
         dec->job_state.stop_requested = true;
     }
     dec->reset_state = true;
@@ -361,6 +497,11 @@ static void flush(mp3_decoder_t* dec) {
     dec->input_count = 0;
 }
 
+static void stop(mp3_decoder_t* dec, decoder_stopped_func_t stopped_func, void* udata) {
+    flush(dec);
+    request_stop(dec->job_state.run_state, stopped_func, udata);
+}
+
 //
 // decoder_ti vtable
 //
@@ -390,6 +531,11 @@ static void mp3dec_flush(void* state) {
     flush(dec);
 }
 
+static void mp3dec_stop(void* state, decoder_stopped_func_t stopped_func, void* udata) {
+    auto dec = (mp3_decoder_t*)state;
+    stop(dec, stopped_func, udata);
+}
+
 constexpr decoder_ti init_mp3_decoder_vt() {
     decoder_ti vt = {};
     vt.release_consumed_inputs = mp3dec_release_consumed_inputs;
@@ -397,6 +543,7 @@ constexpr decoder_ti init_mp3_decoder_vt() {
     vt.next_output = mp3dec_next_output;
     vt.is_running = mp3dec_is_running;
     vt.flush = mp3dec_flush;
+    vt.stop = mp3dec_stop;
 
     return vt;
 }
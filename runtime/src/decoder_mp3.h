@@ -2,7 +2,8 @@
 
 #include "decoder.h"
 #include "internal_alloc_types.h"
-#include "internal_jobs_types.h"
+#include "decode_scheduler.h"
+#include "scratch_pool.h"
 
 namespace hle_audio {
 namespace rt {
@@ -11,9 +12,21 @@ struct mp3_decoder_t;
 
 struct mp3_decoder_create_info_t {
     allocator_t allocator;
-    jobs_t jobs;
+    decode_scheduler_t* scheduler;
+
+    // stitching buffers, block should fit at least 16KB
+    scratch_pool_t* aux_pool;
+
+    // decoded output ring length, rounded up to power of 2 frames count
+    uint32_t output_ring_ms;
+    bool s16_output;
 };
 
+/**
+ * per voice memory, without shared aux blocks
+ */
+size_t get_decoder_memory_size(const mp3_decoder_create_info_t& info);
+
 mp3_decoder_t* create_decoder(const mp3_decoder_create_info_t& info);
 void destroy(mp3_decoder_t* dec);
 
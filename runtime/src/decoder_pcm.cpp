@@ -1,5 +1,8 @@
 #include "decoder_pcm.h"
 
+#include <cstring>
+#include <algorithm>
+
 #include "alloc_utils.inl"
 
 namespace hle_audio {
@@ -7,18 +10,28 @@ namespace rt {
 
 /**
  * @brief pcm decoder
- * todo:
- *  - support streaming data source (multiple inputs)
+ * inputs are passed through as outputs trimmed to whole frames,
+ * frame split by inputs boundary is stitched and returned as a separate single frame output
  */
 
 static const size_t MAX_INPUT_BUFFERS = 2;
 
+// 8 channels of 32 bit samples
+static const size_t MAX_PCM_FRAME_BYTE_SIZE = 32;
+
 struct pcm_decoder_t {
     allocator_t allocator;
+    uint32_t frame_byte_size;
 
     data_buffer_t inputs[MAX_INPUT_BUFFERS];
     uint8_t input_count;
     uint8_t consumed_input_count;
+
+    // bytes of current input used to complete stitched frame
+    size_t input_offset;
+
+    uint8_t stitch_buf[MAX_PCM_FRAME_BYTE_SIZE];
+    uint32_t stitch_size;
 };
 
 using hle_audio::rt::data_buffer_t;
@@ -29,6 +42,7 @@ pcm_decoder_t* create_decoder(const pcm_decoder_create_info_t& info) {
     auto dec = allocate<pcm_decoder_t>(info.allocator);
     *dec = {};
     dec->allocator = info.allocator;
+    reset(dec, info.frame_byte_size);
     return dec;
 }
 
@@ -36,9 +50,14 @@ void destroy(pcm_decoder_t* dec) {
     deallocate(dec->allocator, dec);
 }
 
-void reset(pcm_decoder_t* dec) {
+void reset(pcm_decoder_t* dec, uint32_t frame_byte_size) {
+    assert(0 < frame_byte_size && frame_byte_size <= MAX_PCM_FRAME_BYTE_SIZE);
+
+    dec->frame_byte_size = frame_byte_size;
     dec->input_count = 0;
     dec->consumed_input_count = 0;
+    dec->input_offset = 0;
+    dec->stitch_size = 0;
 }
 
 static size_t release_consumed_inputs(pcm_decoder_t* dec) {
@@ -55,7 +74,7 @@ static size_t release_consumed_inputs(pcm_decoder_t* dec) {
     return consumed_input_count;
 }
 
-static bool queue_input(pcm_decoder_t* dec, const data_buffer_t& buf, bool last_input) {
+static bool queue_input(pcm_decoder_t* dec, const data_buffer_t& buf, bool /*last_input*/) {
     // should not be the case ever, ?assert?
     if (dec->input_count == MAX_INPUT_BUFFERS) return false;
 
@@ -64,26 +83,84 @@ static bool queue_input(pcm_decoder_t* dec, const data_buffer_t& buf, bool last_
     return true;
 }
 
+/**
+ * move the rest of current input to stitch buffer and switch to the next input
+ */
+static void consume_input(pcm_decoder_t* dec, size_t used_size) {
+    auto& input = dec->inputs[dec->consumed_input_count];
+    assert(dec->input_offset + used_size <= input.size);
+
+    auto rest_size = input.size - dec->input_offset - used_size;
+    assert(dec->stitch_size + rest_size < dec->frame_byte_size);
+
+    memcpy(&dec->stitch_buf[dec->stitch_size], input.data + dec->input_offset + used_size, rest_size);
+    dec->stitch_size += uint32_t(rest_size);
+
+    dec->input_offset = 0;
+    ++dec->consumed_input_count;
+}
+
+static bool is_stitch_output(const pcm_decoder_t* dec, const data_buffer_t& output_buf) {
+    return output_buf.data == dec->stitch_buf;
+}
+
 static void release_output(pcm_decoder_t* dec, data_buffer_t output_buf) {
     if (!output_buf.size) return;
 
-    assert(dec->input_count);
-    assert(dec->inputs[dec->consumed_input_count].data == output_buf.data);
-    assert(dec->inputs[dec->consumed_input_count].size == output_buf.size);
+    if (is_stitch_output(dec, output_buf)) {
+        dec->stitch_size = 0;
+        return;
+    }
 
-    ++dec->consumed_input_count;
+    assert(dec->consumed_input_count < dec->input_count);
+    assert(dec->inputs[dec->consumed_input_count].data + dec->input_offset == output_buf.data);
+
+    consume_input(dec, output_buf.size);
 }
 
 static data_buffer_t next_output(pcm_decoder_t* dec, const data_buffer_t& output_buf) {
     // release previous buffer
     release_output(dec, output_buf);
 
-    return dec->consumed_input_count < dec->input_count ? dec->inputs[dec->consumed_input_count] : empty_data_buffer;
+    while (dec->consumed_input_count < dec->input_count) {
+        auto& input = dec->inputs[dec->consumed_input_count];
+
+        // complete the frame split by previous input
+        if (dec->stitch_size) {
+            auto copy_size = std::min(size_t(dec->frame_byte_size - dec->stitch_size), input.size - dec->input_offset);
+            memcpy(&dec->stitch_buf[dec->stitch_size], input.data + dec->input_offset, copy_size);
+            dec->stitch_size += uint32_t(copy_size);
+            dec->input_offset += copy_size;
+
+            if (dec->stitch_size == dec->frame_byte_size) {
+                data_buffer_t res = {};
+                res.data = dec->stitch_buf;
+                res.size = dec->frame_byte_size;
+                return res;
+            }
+
+            // input is smaller than a frame
+            consume_input(dec, 0);
+            continue;
+        }
+
+        auto whole_frames_size = (input.size - dec->input_offset) / dec->frame_byte_size * dec->frame_byte_size;
+        if (whole_frames_size == 0) {
+            consume_input(dec, 0);
+            continue;
+        }
+
+        data_buffer_t res = {};
+        res.data = input.data + dec->input_offset;
+        res.size = whole_frames_size;
+        return res;
+    }
+
+    return empty_data_buffer;
 }
 
 static void flush(pcm_decoder_t* dec) {
-    dec->consumed_input_count = 0;
-    dec->input_count = 0;
+    reset(dec, dec->frame_byte_size);
 }
 
 
@@ -106,7 +183,7 @@ static data_buffer_t pcm_dec_next_output(void* state, const data_buffer_t& curre
     return next_output(dec, current_buf);
 }
 
-static bool pcm_dec_is_running(void* state) {
+static bool pcm_dec_is_running(void* /*state*/) {
     // no async tasks for pcm
     return false;
 }
@@ -116,6 +193,14 @@ static void pcm_dec_flush(void* state) {
     flush(dec);
 }
 
+static void pcm_dec_stop(void* state, decoder_stopped_func_t stopped_func, void* udata) {
+    auto dec = (pcm_decoder_t*)state;
+    flush(dec);
+
+    // synchronous, nothing to wait for
+    stopped_func(udata);
+}
+
 constexpr decoder_ti init_wav_decoder_vt() {
     decoder_ti vt = {};
     vt.release_consumed_inputs = pcm_dec_release_consumed_inputs;
@@ -123,6 +208,7 @@ constexpr decoder_ti init_wav_decoder_vt() {
     vt.next_output = pcm_dec_next_output;
     vt.is_running = pcm_dec_is_running;
     vt.flush = pcm_dec_flush;
+    vt.stop = pcm_dec_stop;
 
     return vt;
 }
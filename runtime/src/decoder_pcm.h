@@ -10,12 +10,13 @@ struct pcm_decoder_t;
 
 struct pcm_decoder_create_info_t {
     allocator_t allocator;
+    uint32_t frame_byte_size; // sample byte size * channels
 };
 
 pcm_decoder_t* create_decoder(const pcm_decoder_create_info_t& info);
 void destroy(pcm_decoder_t* dec);
 
-void reset(pcm_decoder_t* dec);
+void reset(pcm_decoder_t* dec, uint32_t frame_byte_size);
 decoder_t cast_to_decoder(pcm_decoder_t* dec);
 
 }
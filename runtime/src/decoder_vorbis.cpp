@@ -0,0 +1,507 @@
+#include "decoder_vorbis.h"
+
+// implementation is compiled within rt_libs (ma_impl.c)
+#define STB_VORBIS_HEADER_ONLY
+#include "stb_vorbis.c"
+
+#include "rt_types.h"
+#include "hlea/runtime.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#include "alloc_utils.inl"
+#include "ring_indices.inl"
+
+namespace hle_audio {
+namespace rt {
+
+static const size_t MAX_VORBIS_INPUT_BUFFERS = 2;
+static const size_t MAX_VORBIS_OUTPUT_BUFFERS = 4;
+
+// interleaved samples per output buffer (1024 stereo frames)
+static const size_t VORBIS_OUTPUT_SAMPLES = 2048;
+
+// has to fit headers and the biggest packet crossing input buffers boundary
+static const size_t VORBIS_AUX_BUFFER_SIZE = 32768;
+
+// stb_vorbis setup and temp memory, streams needing more fail to open (VORBIS_outofmem)
+static const size_t VORBIS_ALLOC_BUFFER_SIZE = 256 * 1024;
+
+struct vorbis_output_buffer_t {
+    float pcm[VORBIS_OUTPUT_SAMPLES];
+    int frame_count;
+    int channels;
+};
+
+struct vorbis_input_buffer_t {
+    data_buffer_t buffer;
+    bool last;
+};
+
+struct vorbis_decoder_t {
+    allocator_t allocator;
+    decode_scheduler_t* scheduler;
+
+    vorbis_input_buffer_t inputs[MAX_VORBIS_INPUT_BUFFERS];
+    uint8_t input_count;
+    uint8_t consumed_input_count;
+
+    bool reset_state;
+
+    struct job_state_t {
+        // buffer from decoder allocator, kept over reset
+        stb_vorbis_alloc vorbis_mem;
+        stb_vorbis* vorbis;
+        bool failed;
+
+        vorbis_input_buffer_t input;
+        bool has_input;
+        bool not_enough_input_data;
+
+        /**
+         * stitch buffer for packets crossing inputs boundary:
+         * [rest of previous input | head of current input]
+         */
+        uint8_t aux_buf[VORBIS_AUX_BUFFER_SIZE];
+        size_t aux_rest_size;
+        size_t aux_size;
+        size_t aux_read;
+
+        // decoded planar frame not yet fully copied into outputs
+        float** pending_pcm;
+        int pending_offset;
+        int pending_count;
+        int channels;
+
+        vorbis_output_buffer_t outputs[MAX_VORBIS_OUTPUT_BUFFERS];
+        ring_indices<uint8_t, MAX_VORBIS_OUTPUT_BUFFERS> output_indices;
+        decoder_run_state_t run_state;
+        std::atomic<bool> stop_requested;
+    } job_state;
+};
+
+static void close_vorbis(vorbis_decoder_t::job_state_t* state) {
+    if (state->vorbis) {
+        stb_vorbis_close(state->vorbis);
+        state->vorbis = nullptr;
+    }
+}
+
+vorbis_decoder_t* create_decoder(const vorbis_decoder_create_info_t& info) {
+    auto dec = allocate<vorbis_decoder_t>(info.allocator);
+    new(dec) vorbis_decoder_t(); // init c++ stuff
+    dec->allocator = info.allocator;
+    dec->scheduler = info.scheduler;
+
+    auto& mem = dec->job_state.vorbis_mem;
+    mem.alloc_buffer = (char*)allocate(info.allocator, VORBIS_ALLOC_BUFFER_SIZE);
+    mem.alloc_buffer_length_in_bytes = int(VORBIS_ALLOC_BUFFER_SIZE);
+
+    return dec;
+}
+
+void destroy(vorbis_decoder_t* dec) {
+    close_vorbis(&dec->job_state);
+    deallocate(dec->allocator, dec->job_state.vorbis_mem.alloc_buffer);
+
+    dec->~vorbis_decoder_t();
+    deallocate(dec->allocator, dec);
+}
+
+void reset(vorbis_decoder_t* dec) {
+    auto alloc = dec->allocator;
+    auto scheduler = dec->scheduler;
+    auto vorbis_mem = dec->job_state.vorbis_mem;
+
+    close_vorbis(&dec->job_state);
+
+    // destroy + create witout allocation
+    dec->~vorbis_decoder_t();
+    new(dec) vorbis_decoder_t(); // init c++ stuff
+    dec->allocator = alloc;
+    dec->scheduler = scheduler;
+    dec->job_state.vorbis_mem = vorbis_mem;
+}
+
+//---------------------------------------------------------------------------------------
+// job
+
+static bool is_aux_active(const vorbis_decoder_t::job_state_t* state) {
+    return state->aux_size != 0;
+}
+
+static void reset_aux(vorbis_decoder_t::job_state_t* state) {
+    state->aux_rest_size = 0;
+    state->aux_size = 0;
+    state->aux_read = 0;
+}
+
+static void consume_input(vorbis_decoder_t::job_state_t* state) {
+    state->input = {};
+    state->has_input = false;
+    state->not_enough_input_data = true;
+}
+
+/**
+ * copy pending decoded frame into output buffers
+ */
+static void write_pending_output(vorbis_decoder_t::job_state_t* state) {
+    auto wp = state->output_indices.write_pos.load();
+    auto& output = state->outputs[wp & (MAX_VORBIS_OUTPUT_BUFFERS - 1)];
+
+    int channels = state->channels;
+    int max_frames = int(VORBIS_OUTPUT_SAMPLES) / channels;
+    int frame_count = state->pending_count < max_frames ? state->pending_count : max_frames;
+
+    float* out_ptr = output.pcm;
+    for (int i = 0; i < frame_count; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            *out_ptr++ = state->pending_pcm[ch][state->pending_offset + i];
+        }
+    }
+    output.frame_count = frame_count;
+    output.channels = channels;
+
+    state->pending_offset += frame_count;
+    state->pending_count -= frame_count;
+
+    state->output_indices.write_pos.store(++wp);
+}
+
+/**
+ * keep the rest of the input to be stitched with the next one
+ * @return false if rest doesn't fit aux buffer
+ */
+static bool keep_rest_input(vorbis_decoder_t::job_state_t* state) {
+    if (is_aux_active(state)) {
+        auto unread_size = state->aux_size - state->aux_read;
+        memmove(state->aux_buf, state->aux_buf + state->aux_read, unread_size);
+        state->aux_rest_size = state->aux_size = unread_size;
+        state->aux_read = 0;
+        return true;
+    }
+
+    auto rest_size = state->input.buffer.size;
+    if (VORBIS_AUX_BUFFER_SIZE < rest_size) return false;
+
+    memcpy(state->aux_buf, state->input.buffer.data, rest_size);
+    state->aux_rest_size = state->aux_size = rest_size;
+    state->aux_read = 0;
+    return true;
+}
+
+static void decode_vorbis(vorbis_decoder_t::job_state_t* state) {
+    /*
+        stb_vorbis requires whole packet in memory, packet crossing inputs boundary is stitched:
+        input: [----*rest][head*------------]
+            =>
+        aux:   [rest|head]
+        decoding continues from input once aux rest part is processed
+    */
+
+    while (state->output_indices.can_write()) {
+        // flushed or stopped, drop the rest
+        if (state->stop_requested) break;
+
+        if (state->pending_count) {
+            write_pending_output(state);
+            continue;
+        }
+
+        if (!state->has_input) break;
+
+        if (state->failed) {
+            consume_input(state);
+            break;
+        }
+
+        // append current input head to the rest of previous one
+        if (is_aux_active(state) && state->aux_size == state->aux_rest_size) {
+            auto head_size = VORBIS_AUX_BUFFER_SIZE - state->aux_size;
+            head_size = head_size < state->input.buffer.size ? head_size : state->input.buffer.size;
+            memcpy(&state->aux_buf[state->aux_size], state->input.buffer.data, head_size);
+            state->aux_size += head_size;
+        }
+
+        const uint8_t* src_data = state->input.buffer.data;
+        int src_size = int(state->input.buffer.size);
+        if (is_aux_active(state)) {
+            src_data = state->aux_buf + state->aux_read;
+            src_size = int(state->aux_size - state->aux_read);
+        }
+
+        int used = 0;
+        int samples = 0;
+        float** pcm = nullptr;
+        if (!state->vorbis) {
+            int error = 0;
+            state->vorbis = stb_vorbis_open_pushdata(src_data, src_size, &used, &error, &state->vorbis_mem);
+            if (!state->vorbis && error != VORBIS_need_more_data) {
+                // broken stream or out of alloc buffer
+                state->failed = true;
+                continue;
+            }
+            if (state->vorbis) {
+                state->channels = stb_vorbis_get_info(state->vorbis).channels;
+                assert(0 < state->channels && size_t(state->channels) <= VORBIS_OUTPUT_SAMPLES);
+            }
+        } else {
+            used = stb_vorbis_decode_frame_pushdata(state->vorbis, src_data, src_size, nullptr, &pcm, &samples);
+        }
+
+        // not enough data for the packet
+        if (used == 0) {
+            bool whole_input_in_aux = is_aux_active(state) && 
+                (state->aux_size - state->aux_rest_size == state->input.buffer.size);
+
+            if (is_aux_active(state) && !whole_input_in_aux) {
+                // packet doesn't fit aux buffer, skip it
+                state->input.buffer = advance(state->input.buffer, state->aux_size - state->aux_rest_size);
+                reset_aux(state);
+                if (state->vorbis) stb_vorbis_flush_pushdata(state->vorbis);
+                continue;
+            }
+
+            if (state->input.last) {
+                // trailing data
+                reset_aux(state);
+            } else if (!keep_rest_input(state)) {
+                reset_aux(state);
+                if (state->vorbis) stb_vorbis_flush_pushdata(state->vorbis);
+            }
+
+            consume_input(state);
+            break;
+        }
+
+        if (is_aux_active(state)) {
+            state->aux_read += used;
+            // use current input when processed aux buffer from previous input
+            if (state->aux_rest_size <= state->aux_read) {
+                state->input.buffer = advance(state->input.buffer, state->aux_read - state->aux_rest_size);
+                reset_aux(state);
+            }
+        } else {
+            state->input.buffer = advance(state->input.buffer, used);
+        }
+
+        if (samples) {
+            state->pending_pcm = pcm;
+            state->pending_offset = 0;
+            state->pending_count = samples;
+            continue;
+        }
+
+        if (!is_aux_active(state) && is_empty(state->input.buffer)) {
+            consume_input(state);
+            break;
+        }
+    }
+
+    finish_running(state->run_state);
+}
+
+static void decode_vorbis_jobfunc(void* udata) {
+    auto state = (vorbis_decoder_t::job_state_t*)udata;
+    decode_vorbis(state);
+}
+
+// job
+//---------------------------------------------------------------------------------------
+
+static size_t release_consumed_inputs(vorbis_decoder_t* dec) {
+    // flushed inputs are gone, flag is dropped on reset
+    if (!is_running(dec->job_state.run_state) && !dec->reset_state) {
+        if (dec->job_state.not_enough_input_data) {
+            dec->job_state.not_enough_input_data = false;
+
+            ++dec->consumed_input_count;
+            assert(dec->input_count);
+        }
+    }
+
+    auto consumed_input_count = dec->consumed_input_count;
+
+    if (consumed_input_count) {
+        for (auto i = consumed_input_count; i < dec->input_count; ++i) {
+            dec->inputs[i - consumed_input_count] = dec->inputs[i];
+        }
+        dec->input_count -= consumed_input_count;
+        dec->consumed_input_count = 0;        
+    }
+
+    return consumed_input_count;
+}
+
+static void reset_inputs(vorbis_decoder_t::job_state_t* state) {
+    state->output_indices.reset();
+    state->stop_requested = false;
+    state->input = {};
+    state->has_input = false;
+    state->not_enough_input_data = false;
+    state->failed = false;
+
+    reset_aux(state);
+
+    state->pending_pcm = nullptr;
+    state->pending_offset = 0;
+    state->pending_count = 0;
+
+    // inputs are queued from the stream start again, headers have to be parsed
+    close_vorbis(state);
+}
+
+static void kick_decoding_job(vorbis_decoder_t* dec) {
+    auto& state = dec->job_state;
+    if (is_running(state.run_state)) return;
+
+    if (dec->reset_state) {
+        dec->reset_state = false;
+        reset_inputs(&state);
+    }
+
+    if (state.not_enough_input_data) {
+        // wait till release_consumed_inputs
+        return;
+    }
+
+    if (!state.has_input && dec->consumed_input_count < dec->input_count) {
+        state.input = dec->inputs[dec->consumed_input_count];
+        state.has_input = true;
+    }
+
+    // do not launch if has nothing to decode
+    if (!state.has_input && !state.pending_count) return;
+
+    // or outputs
+    if (!state.output_indices.can_write()) return;
+
+    // launch decoder job
+    start_running(state.run_state);
+
+    hlea_job_t job  = {};
+    job.job_func = decode_vorbis_jobfunc;
+    job.udata = &state;
+    schedule(dec->scheduler, job, state.output_indices.used_count() * VORBIS_OUTPUT_SAMPLES);
+}
+
+static bool queue_input(vorbis_decoder_t* dec, const data_buffer_t& buf, bool last_input) {
+    if (dec->input_count == MAX_VORBIS_INPUT_BUFFERS) return false;
+
+    vorbis_input_buffer_t input = {};
+    input.buffer = buf;
+    input.last = last_input;
+    dec->inputs[dec->input_count++] = input;
+
+    kick_decoding_job(dec);
+
+    return true;
+}
+
+static void release_output(vorbis_decoder_t* dec, data_buffer_t output_buf) {
+    if (output_buf.size) {
+        auto rp = dec->job_state.output_indices.read_pos.load();
+        dec->job_state.output_indices.read_pos.store(++rp);
+
+        // we now have one vacant output buffer to decode into
+        kick_decoding_job(dec);
+    }
+}
+
+static data_buffer_t next_output(vorbis_decoder_t* dec, const data_buffer_t& current_buf) {
+    // release previous buffer
+    release_output(dec, current_buf);
+
+    auto rp = dec->job_state.output_indices.read_pos.load();
+
+    // return empty if next is still writing
+    auto wp = dec->job_state.output_indices.write_pos.load();
+    if (rp == wp) {
+        return {};
+    }
+
+    auto& output = dec->job_state.outputs[rp & (MAX_VORBIS_OUTPUT_BUFFERS - 1)];
+
+    data_buffer_t res = {};
+    res.data = (uint8_t*)output.pcm;
+    res.size = output.frame_count * output.channels * sizeof(float);
+    return res;
+}
+
+static bool is_running(const vorbis_decoder_t* dec) {
+    return is_running(dec->job_state.run_state);
+}
+
+static void flush(vorbis_decoder_t* dec) {
+    if (is_running(dec->job_state.run_state)) {
+        dec->job_state.stop_requested = true;
+    }
+    dec->reset_state = true;
+    dec->consumed_input_count = 0;
+    dec->input_count = 0;
+}
+
+static void stop(vorbis_decoder_t* dec, decoder_stopped_func_t stopped_func, void* udata) {
+    flush(dec);
+    request_stop(dec->job_state.run_state, stopped_func, udata);
+}
+
+//
+// decoder_ti vtable
+//
+
+static size_t vorbisdec_release_consumed_inputs(void* state) {
+    auto dec = (vorbis_decoder_t*)state;
+    return release_consumed_inputs(dec);
+}
+
+static bool vorbisdec_queue_input(void* state, const data_buffer_t& buf, bool last_input) {
+    auto dec = (vorbis_decoder_t*)state;
+    return queue_input(dec, buf, last_input);
+}
+
+static data_buffer_t vorbisdec_next_output(void* state, const data_buffer_t& current_buf) {
+    auto dec = (vorbis_decoder_t*)state;
+    return next_output(dec, current_buf);
+}
+
+static bool vorbisdec_is_running(void* state) {
+    auto dec = (vorbis_decoder_t*)state;
+    return is_running(dec);
+}
+
+static void vorbisdec_flush(void* state) {
+    auto dec = (vorbis_decoder_t*)state;
+    flush(dec);
+}
+
+static void vorbisdec_stop(void* state, decoder_stopped_func_t stopped_func, void* udata) {
+    auto dec = (vorbis_decoder_t*)state;
+    stop(dec, stopped_func, udata);
+}
+
+constexpr decoder_ti init_vorbis_decoder_vt() {
+    decoder_ti vt = {};
+    vt.release_consumed_inputs = vorbisdec_release_consumed_inputs;
+    vt.queue_input = vorbisdec_queue_input;
+    vt.next_output = vorbisdec_next_output;
+    vt.is_running = vorbisdec_is_running;
+    vt.flush = vorbisdec_flush;
+    vt.stop = vorbisdec_stop;
+
+    return vt;
+}
+
+static const decoder_ti g_vorbis_decoder_vt = init_vorbis_decoder_vt();
+
+decoder_t cast_to_decoder(vorbis_decoder_t* dec) {
+    decoder_t res = {};
+    res.vt = &g_vorbis_decoder_vt;
+    res.state = dec;
+    return res;
+}
+
+}
+}
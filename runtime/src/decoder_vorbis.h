@@ -0,0 +1,24 @@
+#pragma once
+
+#include "decoder.h"
+#include "internal_alloc_types.h"
+#include "decode_scheduler.h"
+
+namespace hle_audio {
+namespace rt {
+
+struct vorbis_decoder_t;
+
+struct vorbis_decoder_create_info_t {
+    allocator_t allocator;
+    decode_scheduler_t* scheduler;
+};
+
+vorbis_decoder_t* create_decoder(const vorbis_decoder_create_info_t& info);
+void destroy(vorbis_decoder_t* dec);
+
+void reset(vorbis_decoder_t* dec);
+decoder_t cast_to_decoder(vorbis_decoder_t* dec);
+
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include "rt_types.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * resolved file_data_t::frame_seek_table_t
+ */
+struct frame_seek_info_t {
+    const uint32_t* frame_offsets;
+    uint32_t entry_count;
+    uint32_t samples_per_frame;
+    uint32_t frames_per_entry;
+};
+
+// main data of mp3 frame could start up to 511 bytes back (few frames on low bitrates)
+static const uint64_t MP3_SEEK_PREROLL_FRAMES = 4;
+
+/**
+ * where decoding starts to reach a frame
+ */
+struct seek_input_t {
+    uint64_t input_offset; // in file data
+    uint64_t skip_frames;  // decoded frames to drop before the target one
+};
+
+/**
+ * decode from the start, unless format has random access blocks or frames table
+ */
+static seek_input_t find_seek_input(const file_data_t::meta_t& meta, const frame_seek_info_t& seek_info, uint64_t frame_index) {
+    seek_input_t res = {};
+    res.skip_frames = frame_index;
+
+    if (meta.coding_format == audio_format_type_e::pcm) {
+        res.input_offset = frame_index * sizeof(int16_t) * meta.channels;
+        res.skip_frames = 0;
+    } else if (meta.coding_format == audio_format_type_e::adpcm) {
+        auto block_index = frame_index / ADPCM_SAMPLES_PER_BLOCK;
+        res.input_offset = block_index * ADPCM_CHANNEL_BLOCK_BYTE_SIZE * meta.channels;
+        res.skip_frames -= block_index * ADPCM_SAMPLES_PER_BLOCK;
+    } else if (seek_info.entry_count) {
+        // start few frames earlier, so bit reservoir and overlap are restored for the target frame
+        auto coded_frame_index = frame_index / seek_info.samples_per_frame;
+        coded_frame_index = MP3_SEEK_PREROLL_FRAMES < coded_frame_index ? coded_frame_index - MP3_SEEK_PREROLL_FRAMES : 0;
+
+        auto entry_index = std::min(uint32_t(coded_frame_index / seek_info.frames_per_entry), seek_info.entry_count - 1);
+        res.input_offset = seek_info.frame_offsets[entry_index];
+        res.skip_frames -= uint64_t(entry_index) * seek_info.frames_per_entry * seek_info.samples_per_frame;
+    }
+
+    return res;
+}
+
+}
+}
@@ -7,10 +7,10 @@ struct ma_engine;
 
 struct bank_streaming_source_info_t {
     using streaming_source_handle = hle_audio::rt::streaming_source_handle;
-    using range_t = hle_audio::rt::range_t;
+    using stream_range_t = hle_audio::rt::stream_range_t;
     
     streaming_source_handle streaming_src;
-    range_t file_range;
+    stream_range_t file_range;
 };
 
 namespace hle_audio {
@@ -2,23 +2,48 @@
 
 #include <cstdint>
 #include <limits>
+#include <atomic>
 #include "rt_types.h"
 #include "streaming_data_source.h"
 #include "buffer_data_source.h"
-#include "node_state_stack.h"
 #include "chunk_streaming_cache.h"
+#include "decode_scheduler.h"
+#include "thread_pool.h"
+#include "pcm_cache.h"
+#include "resident_data_cache.h"
+#include "scratch_pool.h"
 #include "decoder_mp3.h"
 #include "decoder_pcm.h"
+#include "decoder_vorbis.h"
+#include "decoder_adpcm.h"
+#include "decoder_flac.h"
+#include "mapped_file.h"
+#include "voice_pool.h"
 
 static const uint16_t MAX_SOUNDS = 1024;
 static const uint16_t MAX_ACTIVE_GROUPS = 128;
 static const uint16_t SOUNDS_UNUSED_LIST = 0u;
 static const uint8_t MAX_OUPUT_BUSES = 32u;
+// audio periods stopped voice is kept before reuse
+static const uint32_t RETIRE_PERIOD_COUNT = 2u;
 static const uint16_t MAX_STREAMING_SOURCES = MAX_SOUNDS;
+static const uint8_t MAX_LOADING_BANKS = 16u;
+static const uint8_t MAX_PREPARED_GROUPS = 32u;
+static const size_t MAX_BANK_PATH = 512;
 
 enum sound_id_t : uint16_t;
 const sound_id_t invalid_sound_id = (sound_id_t)0u;
 
+struct hlea_context_t;
+
+/**
+ * decoder stop notification target, sound is recycled once its decoder job is stopped
+ */
+struct sound_stop_notify_t {
+    hlea_context_t* ctx;
+    sound_id_t sound_id;
+};
+
 struct sound_data_t {
     using decoder_t = hle_audio::rt::decoder_t;
     using audio_format_type_e = hle_audio::rt::audio_format_type_e;
@@ -29,25 +54,66 @@ struct sound_data_t {
     audio_format_type_e coding_format;
     uint16_t dec_index;
 
+    // decoder is not used when sound is played from pcm cache
+    hle_audio::rt::pcm_cache_entry_t* cached_pcm;
+    hle_audio::rt::pcm_cache_entry_t* filling_pcm;
+
+    // buffer source input of lazily loaded bank
+    hle_audio::rt::resident_data_entry_t* resident_data;
+
     streaming_data_source_t* str_src;
     buffer_data_source_t* buffer_src;
-    ma_sound      engine_sound;
+    sound_stop_notify_t stop_notify;
+    hle_audio::rt::voice_t* voice;
+};
+
+/**
+ * stopped sound waiting for the audio thread to leave its voice
+ */
+struct retiring_sound_t {
+    sound_id_t sound_id;
+    uint32_t period;
+};
+
+enum class bank_load_state_e : uint8_t {
+    ready = 0,
+    opening,    // files are being opened by a job
+    reading,    // blob is being read by async reader
+    validating, // blob is being checked by a job
+    failed
+};
+
+struct bank_async_load_t;
+
+/**
+ * stream file opened once for all banks referencing it by the same name,
+ * banks built with shared stream file read common samples through one cache source
+ */
+struct stream_file_t {
+    stream_file_t* next;
+    uint32_t ref_count;
+    char filename[MAX_BANK_PATH];
+
+    ma_vfs_file file;
+    hle_audio::rt::async_file_handle_t afile;
+    hle_audio::rt::mapped_file_t mapping;
+    hle_audio::rt::streaming_source_handle cache_src;
 };
 
 struct hlea_event_bank_t {
+    bank_load_state_e load_state;
+    bank_async_load_t* async_load; // set while async loading is in progress
+
     hle_audio::rt::buffer_t data_buffer_ptr;
     const hle_audio::rt::store_t* static_data;
-    ma_vfs_file streaming_file;
-    hle_audio::rt::async_file_handle_t streaming_afile;
-    hle_audio::rt::streaming_source_handle streaming_cache_src;
-};
+    bool owns_data; // data_buffer_ptr is allocated with context allocator
+    hle_audio::rt::mapped_file_t data_mapping; // set when blob is used in place from mapped file
 
-struct sequence_rt_state_t {
-    uint32_t current_index;
-};
+    // set when resident sample data is not loaded with the blob, but read on demand
+    ma_vfs_file data_file;
+    hle_audio::rt::async_file_handle_t data_afile;
 
-struct repeat_rt_state_t {
-    uint32_t iteration_counter;
+    stream_file_t* stream_file; // shared with other banks
 };
 
 enum class playing_state_e {
@@ -68,7 +134,9 @@ struct group_data_t {
 
     bool apply_sound_fade_out;
 
-    hle_audio::rt::node_state_stack_t state_stack;
+    // group program position, op after last produced sound
+    uint32_t program_pc;
+    uint16_t loop_counters[hle_audio::rt::MAX_PROGRAM_LOOP_DEPTH];
 };
 
 struct event_desc_t {
@@ -107,6 +175,21 @@ struct array_with_size_t {
         assert(0 < size);
         return vec[--size];
     }
+
+    void swap_remove(CountType index) {
+        assert(index < size);
+        vec[index] = vec[--size];
+    }
+};
+
+/**
+ * silent node attached to the engine endpoint, its processing marks audio period for decode scheduler
+ * and counts periods, so game thread knows when audio thread is done with stopped voices
+ */
+struct decode_tick_node_t {
+    ma_node_base base;
+    hle_audio::rt::decode_scheduler_t* scheduler;
+    std::atomic<uint32_t> period_counter;
 };
 
 struct hlea_context_t {
@@ -116,15 +199,24 @@ struct hlea_context_t {
     vfs_bridge_t vfs_impl;
     ma_default_vfs vfs_default;
 
-    ma_device_job_thread task_executor;
+    hle_audio::rt::thread_pool_t* thread_pool;
 
     ma_vfs* pVFS;
     allocator_t allocator;
     jobs_t jobs;
     hle_audio::rt::async_file_reader_t* async_io;
     hle_audio::rt::chunk_streaming_cache_t* streaming_cache;
+    hle_audio::rt::decode_scheduler_t* decode_scheduler;
+    hle_audio::rt::pcm_cache_t* pcm_cache;
+    hle_audio::rt::resident_data_cache_t* resident_data_cache;
+    hle_audio::rt::voice_pool_t* voice_pool;
+    bool use_mapped_streaming;
+    hle_audio::rt::scratch_pool_t* mp3_aux_pool;
+    uint16_t mp3_output_ring_ms;
+    bool mp3_s16_output;
 
     ma_engine engine;
+    decode_tick_node_t decode_tick_node;
 
 #ifdef HLEA_USE_RT_EDITOR
     hle_audio::rt::editor_runtime_t* editor_hooks;
@@ -140,13 +232,27 @@ struct hlea_context_t {
     sound_id_t recycled_sounds[MAX_SOUNDS];
     uint16_t recycled_count;
 
-    // todo: use recycled_sounds tail block for pending
-    sound_id_t pending_sounds[MAX_SOUNDS];
-    uint16_t pending_sounds_size;
+    retiring_sound_t retiring_sounds[MAX_SOUNDS];
+    uint16_t retiring_sounds_size;
+
+    // sounds with stopped decoders, pushed from job threads
+    ma_spinlock stopped_sounds_lock;
+    sound_id_t stopped_sounds[MAX_SOUNDS];
+    uint16_t stopped_sounds_size;
+    uint16_t stopping_sounds_count; // stop requested, not called back yet
 
     group_data_t active_groups[MAX_ACTIVE_GROUPS];
     uint16_t active_groups_size;
 
+    // made but not started groups, waiting for play
+    array_with_size_t<group_data_t, MAX_PREPARED_GROUPS, uint8_t> prepared_groups;
+    uint16_t prepare_ms;
+    uint32_t prepared_start_count;
+    uint32_t cold_start_count;
+
+    array_with_size_t<hlea_event_bank_t*, MAX_LOADING_BANKS, uint8_t> loading_banks;
+    stream_file_t* stream_files; // opened by loaded banks
+
     array_with_size_t<streaming_data_source_t, MAX_STREAMING_SOURCES, uint16_t> streaming_sources;
     array_with_size_t<uint16_t, MAX_STREAMING_SOURCES, uint16_t> unused_streaming_sources_indices;
 
@@ -158,4 +264,13 @@ struct hlea_context_t {
 
     array_with_size_t<hle_audio::rt::pcm_decoder_t*, MAX_SOUNDS, uint16_t> decoders_pcm;
     array_with_size_t<uint16_t, MAX_SOUNDS, uint16_t> unused_decoders_pcm_indices;
+
+    array_with_size_t<hle_audio::rt::vorbis_decoder_t*, MAX_SOUNDS, uint16_t> decoders_vorbis;
+    array_with_size_t<uint16_t, MAX_SOUNDS, uint16_t> unused_decoders_vorbis_indices;
+
+    array_with_size_t<hle_audio::rt::adpcm_decoder_t*, MAX_SOUNDS, uint16_t> decoders_adpcm;
+    array_with_size_t<uint16_t, MAX_SOUNDS, uint16_t> unused_decoders_adpcm_indices;
+
+    array_with_size_t<hle_audio::rt::flac_decoder_t*, MAX_SOUNDS, uint16_t> decoders_flac;
+    array_with_size_t<uint16_t, MAX_SOUNDS, uint16_t> unused_decoders_flac_indices;
 };
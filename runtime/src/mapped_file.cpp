@@ -0,0 +1,135 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define HLEA_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hle_audio {
+namespace rt {
+
+static const size_t PAGE_SIZE_MIN = 4096;
+
+#if defined(_WIN32)
+
+bool map_file(const char* file_path, mapped_file_t* out_mapped) {
+    HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size = {};
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mapped_file_t res = {};
+    res.data = (const uint8_t*)data;
+    res.size = (size_t)file_size.QuadPart;
+    res.file_handle = (intptr_t)file;
+    res.mapping_handle = (intptr_t)mapping;
+    *out_mapped = res;
+
+    return true;
+}
+
+void unmap_file(mapped_file_t* mapped) {
+    if (!mapped->data) return;
+
+    UnmapViewOfFile(mapped->data);
+    CloseHandle((HANDLE)mapped->mapping_handle);
+    CloseHandle((HANDLE)mapped->file_handle);
+    *mapped = {};
+}
+
+#elif defined(HLEA_HAS_MMAP)
+
+bool map_file(const char* file_path, mapped_file_t* out_mapped) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    // access pattern is driven by chunk prefetching, kernel readahead only wastes page cache
+    madvise(data, (size_t)st.st_size, MADV_RANDOM);
+
+    mapped_file_t res = {};
+    res.data = (const uint8_t*)data;
+    res.size = (size_t)st.st_size;
+    res.file_handle = fd;
+    *out_mapped = res;
+
+    return true;
+}
+
+void unmap_file(mapped_file_t* mapped) {
+    if (!mapped->data) return;
+
+    munmap((void*)mapped->data, mapped->size);
+    close((int)mapped->file_handle);
+    *mapped = {};
+}
+
+#else
+
+bool map_file(const char* file_path, mapped_file_t* out_mapped) {
+    return false;
+}
+
+void unmap_file(mapped_file_t* mapped) {
+    *mapped = {};
+}
+
+#endif
+
+void prefetch_mapped_range(const_data_buffer_t range) {
+    if (!range.size) return;
+
+#if defined(HLEA_HAS_MMAP)
+    // madvise expects page aligned address
+    auto page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    auto begin = (uintptr_t)range.data & ~(page_size - 1);
+    auto end = (uintptr_t)range.data + range.size;
+    madvise((void*)begin, end - begin, MADV_WILLNEED);
+#endif
+
+    // WILLNEED only starts readahead, touch pages to make sure they're resident
+    // before the range is reported as ready (decoders may run on the audio thread)
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < range.size; offset += PAGE_SIZE_MIN) {
+        sink += range.data[offset];
+    }
+    sink += range.data[range.size - 1];
+}
+
+}
+}
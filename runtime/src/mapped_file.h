@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include "rt_types.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * @brief read-only memory mapping of a whole file
+ */
+struct mapped_file_t {
+    const uint8_t* data;
+    size_t size;
+
+    intptr_t file_handle;
+    intptr_t mapping_handle; // windows only
+};
+
+/**
+ * @brief map file into memory (os file path, not going through file api)
+ * 
+ * @return true on success, false if file couldn't be mapped or mapping is not supported on the platform
+ */
+bool map_file(const char* file_path, mapped_file_t* out_mapped);
+void unmap_file(mapped_file_t* mapped);
+
+/**
+ * @brief hint the range is needed soon and fault its pages in,
+ * blocks until pages are resident, so expected to be called from a helper thread
+ */
+void prefetch_mapped_range(const_data_buffer_t range);
+
+}
+}
@@ -0,0 +1,248 @@
+#include "pcm_cache.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#include "alloc_utils.inl"
+#include "data_source_utils.inl"
+#include "internal/memory_utils.inl"
+
+namespace hle_audio {
+namespace rt {
+
+static const uint32_t PCM_CACHE_BUCKET_COUNT = 256;
+
+struct pcm_cache_entry_t {
+    pcm_cache_key_t key;
+
+    // lru list, head is the most recently used
+    pcm_cache_entry_t* lru_prev;
+    pcm_cache_entry_t* lru_next;
+    pcm_cache_entry_t* bucket_next;
+
+    uint32_t ref_count;
+    bool filling;
+    bool orphaned; // removed from lookup, freed on last release
+
+    uint8_t frame_byte_size;
+    uint64_t frame_count;
+    size_t alloc_size;
+
+    std::atomic<uint64_t> filled_frame_count;
+    std::atomic<bool> fill_canceled;
+
+    uint8_t* frames;
+};
+
+struct pcm_cache_t {
+    allocator_t allocator;
+    size_t budget_bytes;
+    size_t max_entry_bytes;
+
+    pcm_cache_entry_t* buckets[PCM_CACHE_BUCKET_COUNT];
+    pcm_cache_entry_t* lru_head;
+    pcm_cache_entry_t* lru_tail;
+
+    pcm_cache_stats_t stats;
+};
+
+pcm_cache_t* create_pcm_cache(const pcm_cache_create_info_t& info) {
+    auto cache = allocate<pcm_cache_t>(info.allocator);
+    *cache = {};
+    cache->allocator = info.allocator;
+    cache->budget_bytes = info.budget_bytes;
+    cache->max_entry_bytes = info.max_entry_bytes < info.budget_bytes ? info.max_entry_bytes : info.budget_bytes;
+
+    return cache;
+}
+
+static void free_entry(pcm_cache_t* cache, pcm_cache_entry_t* entry) {
+    cache->stats.used_bytes -= entry->alloc_size;
+    --cache->stats.entry_count;
+
+    entry->~pcm_cache_entry_t();
+    deallocate(cache->allocator, entry);
+}
+
+void destroy(pcm_cache_t* cache) {
+    // sounds are expected to be released already
+    for (auto entry = cache->lru_head; entry;) {
+        auto next = entry->lru_next;
+        free_entry(cache, entry);
+        entry = next;
+    }
+
+    deallocate(cache->allocator, cache);
+}
+
+//---------------------------------------------------------------------------------------
+// lookup
+
+static uint32_t bucket_index(pcm_cache_key_t key) {
+    auto h = uint64_t(uintptr_t(key.owner)) * 0x9E3779B97F4A7C15ull ^ key.file_index * 0xC2B2AE3Du;
+    return uint32_t(h >> 32) & (PCM_CACHE_BUCKET_COUNT - 1);
+}
+
+static pcm_cache_entry_t* find(pcm_cache_t* cache, pcm_cache_key_t key) {
+    for (auto entry = cache->buckets[bucket_index(key)]; entry; entry = entry->bucket_next) {
+        if (entry->key.owner == key.owner && entry->key.file_index == key.file_index) return entry;
+    }
+    return nullptr;
+}
+
+static void lru_unlink(pcm_cache_t* cache, pcm_cache_entry_t* entry) {
+    (entry->lru_prev ? entry->lru_prev->lru_next : cache->lru_head) = entry->lru_next;
+    (entry->lru_next ? entry->lru_next->lru_prev : cache->lru_tail) = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = nullptr;
+}
+
+static void lru_push_front(pcm_cache_t* cache, pcm_cache_entry_t* entry) {
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = entry;
+    cache->lru_head = entry;
+    if (!cache->lru_tail) cache->lru_tail = entry;
+}
+
+/**
+ * remove from lookup and lru, entry is freed by caller or on last release
+ */
+static void unlink(pcm_cache_t* cache, pcm_cache_entry_t* entry) {
+    auto link = &cache->buckets[bucket_index(entry->key)];
+    while (*link != entry) link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+
+    lru_unlink(cache, entry);
+    entry->orphaned = true;
+}
+
+static bool evict_to_fit(pcm_cache_t* cache, size_t size) {
+    auto entry = cache->lru_tail;
+    while (cache->budget_bytes < cache->stats.used_bytes + size && entry) {
+        auto prev = entry->lru_prev;
+        if (!entry->ref_count) {
+            unlink(cache, entry);
+            free_entry(cache, entry);
+        }
+        entry = prev;
+    }
+
+    return cache->stats.used_bytes + size <= cache->budget_bytes;
+}
+
+//---------------------------------------------------------------------------------------
+
+bool is_cacheable(const pcm_cache_t* cache, ma_format format, uint8_t channels, uint64_t frame_count) {
+    uint64_t frames_size = frame_count * get_sample_byte_size(format) * channels;
+    return frames_size && frames_size <= cache->max_entry_bytes;
+}
+
+pcm_cache_entry_t* acquire(pcm_cache_t* cache, pcm_cache_key_t key) {
+    auto entry = find(cache, key);
+    if (!entry || entry->filling) {
+        ++cache->stats.misses;
+        return nullptr;
+    }
+
+    ++cache->stats.hits;
+    ++entry->ref_count;
+
+    lru_unlink(cache, entry);
+    lru_push_front(cache, entry);
+
+    return entry;
+}
+
+void release(pcm_cache_t* cache, pcm_cache_entry_t* entry) {
+    assert(entry->ref_count);
+    --entry->ref_count;
+
+    if (!entry->ref_count && entry->orphaned) {
+        free_entry(cache, entry);
+    }
+}
+
+pcm_cache_entry_t* begin_fill(pcm_cache_t* cache, pcm_cache_key_t key, ma_format format, uint8_t channels, uint64_t frame_count) {
+    // some voice is filling it already
+    if (find(cache, key)) return nullptr;
+
+    if (!is_cacheable(cache, format, channels, frame_count)) return nullptr;
+
+    uint8_t frame_byte_size = get_sample_byte_size(format) * channels;
+    uint64_t frames_size = frame_count * frame_byte_size;
+
+    auto frames_offset = align_forward(sizeof(pcm_cache_entry_t), alignof(float));
+    auto alloc_size = frames_offset + size_t(frames_size);
+    if (!evict_to_fit(cache, alloc_size)) return nullptr;
+
+    auto mem = (uint8_t*)allocate(cache->allocator, alloc_size, alignof(pcm_cache_entry_t));
+    auto entry = new(mem) pcm_cache_entry_t();
+    entry->key = key;
+    entry->ref_count = 1;
+    entry->filling = true;
+    entry->frame_byte_size = frame_byte_size;
+    entry->frame_count = frame_count;
+    entry->alloc_size = alloc_size;
+    entry->frames = mem + frames_offset;
+
+    auto& bucket = cache->buckets[bucket_index(key)];
+    entry->bucket_next = bucket;
+    bucket = entry;
+    lru_push_front(cache, entry);
+
+    cache->stats.used_bytes += alloc_size;
+    ++cache->stats.entry_count;
+
+    return entry;
+}
+
+void fill(pcm_cache_entry_t* entry, uint64_t frame_offset, const void* frames, uint64_t frame_count) {
+    if (entry->fill_canceled) return;
+
+    auto filled = entry->filled_frame_count.load();
+    // complete already, e.g. looped
+    if (filled == entry->frame_count) return;
+
+    if (frame_offset != filled || entry->frame_count < filled + frame_count) {
+        entry->fill_canceled = true;
+        return;
+    }
+
+    memcpy(entry->frames + filled * entry->frame_byte_size, frames, size_t(frame_count * entry->frame_byte_size));
+    entry->filled_frame_count = filled + frame_count;
+}
+
+void end_fill(pcm_cache_t* cache, pcm_cache_entry_t* entry) {
+    assert(entry->filling);
+
+    bool complete = !entry->fill_canceled && entry->filled_frame_count == entry->frame_count;
+    if (complete) {
+        entry->filling = false;
+    } else if (!entry->orphaned) {
+        unlink(cache, entry);
+    }
+
+    release(cache, entry);
+}
+
+void invalidate(pcm_cache_t* cache, const void* owner) {
+    for (auto entry = cache->lru_head; entry;) {
+        auto next = entry->lru_next;
+        if (entry->key.owner == owner) {
+            unlink(cache, entry);
+            if (!entry->ref_count) free_entry(cache, entry);
+        }
+        entry = next;
+    }
+}
+
+const void* get_frames(const pcm_cache_entry_t* entry) {
+    return entry->frames;
+}
+
+pcm_cache_stats_t get_stats(const pcm_cache_t* cache) {
+    return cache->stats;
+}
+
+}
+}
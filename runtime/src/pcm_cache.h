@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "internal_alloc_types.h"
+#include "miniaudio_public.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * LRU cache of fully decoded short resident sounds, shared across voices.
+ * entries are filled by the first voice playing the sound and read by later ones,
+ * all functions except fill are called from the game thread
+ */
+struct pcm_cache_t;
+struct pcm_cache_entry_t;
+
+struct pcm_cache_create_info_t {
+    allocator_t allocator;
+    size_t budget_bytes;
+    size_t max_entry_bytes;
+};
+
+struct pcm_cache_stats_t {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t entry_count;
+    size_t used_bytes;
+};
+
+/**
+ * sound identity, owner is a bank,
+ * or stream file shared by banks built together with file_index being resident data content id
+ */
+struct pcm_cache_key_t {
+    const void* owner;
+    uint32_t file_index;
+};
+
+pcm_cache_t* create_pcm_cache(const pcm_cache_create_info_t& info);
+void destroy(pcm_cache_t* cache);
+
+/**
+ * decoded sound fits into cache entry
+ */
+bool is_cacheable(const pcm_cache_t* cache, ma_format format, uint8_t channels, uint64_t frame_count);
+
+/**
+ * @brief acquire reference to decoded sound
+ * @return nullptr if sound is not cached or still being filled
+ */
+pcm_cache_entry_t* acquire(pcm_cache_t* cache, pcm_cache_key_t key);
+void release(pcm_cache_t* cache, pcm_cache_entry_t* entry);
+
+/**
+ * @brief start caching decoded sound, evicts unused entries to fit the budget
+ * @return entry referenced by filling voice, nullptr if sound doesn't fit or is already being filled
+ */
+pcm_cache_entry_t* begin_fill(pcm_cache_t* cache, pcm_cache_key_t key, ma_format format, uint8_t channels, uint64_t frame_count);
+
+/**
+ * @brief append decoded frames, fill is canceled on non sequential write (seek)
+ * called from the audio thread
+ */
+void fill(pcm_cache_entry_t* entry, uint64_t frame_offset, const void* frames, uint64_t frame_count);
+
+/**
+ * @brief release filling voice reference, entry becomes available if it's completely filled, dropped otherwise
+ */
+void end_fill(pcm_cache_t* cache, pcm_cache_entry_t* entry);
+
+/**
+ * drop entries of unloaded owner, referenced ones are freed on last release
+ */
+void invalidate(pcm_cache_t* cache, const void* owner);
+
+const void* get_frames(const pcm_cache_entry_t* entry);
+
+pcm_cache_stats_t get_stats(const pcm_cache_t* cache);
+
+}
+}
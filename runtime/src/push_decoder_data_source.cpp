@@ -14,19 +14,72 @@ void init(push_decoder_data_source_t& src, const push_decoder_data_source_init_i
     src.streaming_cache = iinfo.streaming_cache;
     src.input_src = iinfo.input_src;
     src.buffer_block = iinfo.buffer_block;
+    src.head = iinfo.head;
     src.decoder = iinfo.decoder;
+    src.pinned_chunk_id = ~0u;
 
     // prepare first chunk
     prepare_next_chunk(src);
 }
 
-void deinit(push_decoder_data_source_t& src) {
-    assert(!is_running(src.decoder) && "decoder should have released its inputs");
+static void release_input(push_decoder_data_source_t& src, const input_chunk_t& input) {
+    if (input.chunk_id == HEAD_INPUT_CHUNK_ID) return;
+
+    release_chunk(*src.streaming_cache, input.chunk_id);
+}
+
+static bool is_input_ready(push_decoder_data_source_t& src, const input_chunk_t& input) {
+    if (input.chunk_id == HEAD_INPUT_CHUNK_ID) return true;
 
+    return chunk_status(*src.streaming_cache, input.chunk_id) == chunk_status_e::READY;
+}
+
+static void release_inputs(push_decoder_data_source_t& src) {
     for (size_t i = 0; i < src.input_count; ++i) {
-        release_chunk(*src.streaming_cache, src.inputs[i].chunk_id);
+        release_input(src, src.inputs[i]);
     }
     src.input_count = 0;
+    src.chunk_buffer = {};
+}
+
+void deinit(push_decoder_data_source_t& src) {
+    assert(!is_running(src.decoder) && "decoder should have released its inputs");
+
+    release_inputs(src);
+
+    if (src.pinned_chunk_id != ~0u) {
+        release_chunk(*src.streaming_cache, src.pinned_chunk_id);
+        src.pinned_chunk_id = ~0u;
+    }
+}
+
+void restart(push_decoder_data_source_t& src, uint64_t block_offset, uint64_t skip_bytes) {
+    assert(block_offset <= src.buffer_block.size);
+
+    flush(src.decoder);
+
+    src.restart_pending = true;
+    src.restart_block_offset = block_offset;
+
+    src.read_buffer = {};
+    src.read_bytes = 0;
+    src.skip_read_bytes = skip_bytes;
+}
+
+void pin_chunk(push_decoder_data_source_t& src, uint64_t block_offset) {
+    if (src.pinned_chunk_id != ~0u || src.buffer_block.size <= block_offset) return;
+
+    // restart from resident head doesn't wait anyway
+    if (block_offset < src.head.size) return;
+
+    chunk_request_t req = {};
+    req.src = src.input_src;
+    req.buffer_block = src.buffer_block;
+    req.block_offset = block_offset;
+    auto ch_res = acquire_chunk(*src.streaming_cache, req);
+
+    // no chunks avaliable, restart would just wait for reading
+    src.pinned_chunk_id = ch_res.index;
 }
 
 /**
@@ -45,6 +98,18 @@ static bool prepare_next_chunk(push_decoder_data_source_t& src) {
         return false;
     }
 
+    // resident head is used in place, chunks follow it
+    if (src.input_block_offset < src.head.size) {
+        input_chunk_t next_input = {};
+        next_input.chunk_id = HEAD_INPUT_CHUNK_ID;
+
+        src.inputs[src.input_count++] = next_input;
+        src.chunk_buffer.data = const_cast<uint8_t*>(src.head.data) + size_t(src.input_block_offset); // read only
+        src.chunk_buffer.size = src.head.size - size_t(src.input_block_offset);
+
+        return true;
+    }
+
     chunk_request_t req = {};
     req.src = src.input_src;
     req.buffer_block = src.buffer_block;
@@ -65,24 +130,29 @@ static bool prepare_next_chunk(push_decoder_data_source_t& src) {
 }
 
 /**
- * @brief 
+ * @brief apply pending restart, release consumed inputs and queue ready ones to decoder
  * 
- * @param src 
- * @param channels 
- * @param frame_out output frame array (frame_count size)
- * @param frame_count number of frames to read
- * @param frames_read out
- * @return true when read successfully (frames_read is 0 when source end is reached)
- * @return false if there is still some data to read, but no data ready (data starvation case)
+ * @param has_more_inputs out, false once all inputs are consumed
+ * @return false if restart waits for stopping decoder job
  */
-bool read_decoded(push_decoder_data_source_t& src, uint8_t channels, uint8_t sample_byte_size, 
-        void* frame_out, uint64_t frame_count, uint64_t* frames_read) {
+static bool update_inputs(push_decoder_data_source_t& src, bool* has_more_inputs) {
+    if (src.restart_pending) {
+        // stopping job could still read current inputs
+        if (is_running(src.decoder)) return false;
+
+        release_inputs(src);
+        src.input_block_offset = src.restart_block_offset;
+        src.restart_pending = false;
+
+        prepare_next_chunk(src);
+    }
+
     // deque ready output
     auto processed_inputs_count = release_consumed_inputs(src.decoder);
     if (processed_inputs_count) {
         // release chunks
         for (size_t i = 0; i < processed_inputs_count; ++i) {
-            release_chunk(*src.streaming_cache, src.inputs[i].chunk_id);
+            release_input(src, src.inputs[i]);
         }
         for (size_t i = processed_inputs_count; i < src.input_count; ++i) {
             src.inputs[i - processed_inputs_count] = src.inputs[i];
@@ -93,7 +163,7 @@ bool read_decoded(push_decoder_data_source_t& src, uint8_t channels, uint8_t sam
     // finished reading file chunk
     if (!is_empty(src.chunk_buffer) && 
             src.input_count && 
-            chunk_status(*src.streaming_cache, src.inputs[src.input_count - 1].chunk_id) == chunk_status_e::READY) {
+            is_input_ready(src, src.inputs[src.input_count - 1])) {
         // queue ready to decode buffer
         bool last_chunk = src.input_block_offset + src.chunk_buffer.size == src.buffer_block.size;
         queue_input(src.decoder, src.chunk_buffer, last_chunk);
@@ -102,20 +172,64 @@ bool read_decoded(push_decoder_data_source_t& src, uint8_t channels, uint8_t sam
         src.chunk_buffer = {};
     }
 
-    bool has_more_inputs = src.input_count > 0;
+    *has_more_inputs = src.input_count > 0;
 
     // request next chunk
     if (is_empty(src.chunk_buffer)) {
         bool has_more_chunks = prepare_next_chunk(src);
-        has_more_inputs |= has_more_chunks;
+        *has_more_inputs |= has_more_chunks;
     }
 
+    return true;
+}
+
+/**
+ * drop decoded frames preceding restart target, frees decoder output for further decoding
+ */
+static void skip_output(push_decoder_data_source_t& src) {
     // acquire ready output buffer
     if (src.read_buffer.size == src.read_bytes) {
         src.read_bytes = 0;
         src.read_buffer = next_output(src.decoder, src.read_buffer);
     }
 
+    while (src.skip_read_bytes && !is_empty(src.read_buffer)) {
+        auto skipped_bytes = std::min<uint64_t>(src.skip_read_bytes, src.read_buffer.size - src.read_bytes);
+        src.read_bytes += skipped_bytes;
+        src.skip_read_bytes -= skipped_bytes;
+
+        if (src.read_buffer.size == src.read_bytes) {
+            src.read_bytes = 0;
+            src.read_buffer = next_output(src.decoder, src.read_buffer);
+        }
+    }
+}
+
+void pump(push_decoder_data_source_t& src) {
+    bool has_more_inputs = false;
+    if (!update_inputs(src, &has_more_inputs)) return;
+
+    skip_output(src);
+}
+
+/**
+ * @brief 
+ * 
+ * @param src 
+ * @param channels 
+ * @param frame_out output frame array (frame_count size)
+ * @param frame_count number of frames to read
+ * @param frames_read out
+ * @return true when read successfully (frames_read is 0 when source end is reached)
+ * @return false if there is still some data to read, but no data ready (data starvation case)
+ */
+bool read_decoded(push_decoder_data_source_t& src, uint8_t channels, uint8_t sample_byte_size, 
+        void* frame_out, uint64_t frame_count, uint64_t* frames_read) {
+    bool has_more_inputs = false;
+    if (!update_inputs(src, &has_more_inputs)) return false;
+
+    skip_output(src);
+
     if (is_empty(src.read_buffer)) {
         if (!has_more_inputs) return true; // no more data
         return false;
@@ -123,14 +237,19 @@ bool read_decoded(push_decoder_data_source_t& src, uint8_t channels, uint8_t sam
 
     uint64_t frames_in_bytes = frame_count * sample_byte_size * channels;
 
-    uint64_t bytes_consumed = std::min(src.read_buffer.size - src.read_bytes, frames_in_bytes);
-    memcpy(frame_out, (uint8_t*)src.read_buffer.data + src.read_bytes, size_t(bytes_consumed));
-    src.read_bytes += bytes_consumed;
+    // fill the request from as many ready output spans as available
+    uint64_t bytes_consumed = 0;
+    while (bytes_consumed < frames_in_bytes && !is_empty(src.read_buffer)) {
+        uint64_t bytes_to_copy = std::min(src.read_buffer.size - src.read_bytes, frames_in_bytes - bytes_consumed);
+        memcpy((uint8_t*)frame_out + bytes_consumed, (uint8_t*)src.read_buffer.data + src.read_bytes, size_t(bytes_to_copy));
+        src.read_bytes += bytes_to_copy;
+        bytes_consumed += bytes_to_copy;
 
-    // request next read buffer
-    if (src.read_buffer.size == src.read_bytes) {
-        src.read_bytes = 0;
-        src.read_buffer = next_output(src.decoder, src.read_buffer);
+        // request next read buffer
+        if (src.read_buffer.size == src.read_bytes) {
+            src.read_bytes = 0;
+            src.read_buffer = next_output(src.decoder, src.read_buffer);
+        }
     }
 
     *frames_read = bytes_consumed / (sample_byte_size * channels);
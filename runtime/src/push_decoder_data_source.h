@@ -7,6 +7,9 @@
 namespace hle_audio {
 namespace rt {
 
+// input fed from resident head, not from cache chunk
+static const uint32_t HEAD_INPUT_CHUNK_ID = ~0u;
+
 struct input_chunk_t {
     uint32_t chunk_id;
 };
@@ -18,32 +21,60 @@ struct push_decoder_data_source_t {
 
     decoder_t decoder;
     streaming_source_handle input_src;
-    range_t buffer_block;
+    stream_range_t buffer_block;
+
+    // first bytes of buffer block kept in memory, decoded without waiting for reads
+    const_data_buffer_t head;
 
     // inputs
     input_chunk_t inputs[MAX_DS_INPUTS];
     uint8_t input_count;
 
     // pending input
-    uint32_t input_block_offset;
+    uint64_t input_block_offset;
     data_buffer_t chunk_buffer;
     async_read_token_t read_token;
 
+    // inputs are switched to restart offset once flushed decoder job is stopped
+    bool restart_pending;
+    uint64_t restart_block_offset;
+
+    // chunk kept in cache for restarts, ~0u if none
+    uint32_t pinned_chunk_id;
+
     // outpus
     data_buffer_t read_buffer;
     uint64_t read_bytes;
+    uint64_t skip_read_bytes;
 };
 
 struct push_decoder_data_source_init_info_t {
     chunk_streaming_cache_t* streaming_cache;
     streaming_source_handle input_src;
-    range_t buffer_block;
+    stream_range_t buffer_block;
+    const_data_buffer_t head;
     decoder_t decoder;
 };
 
 void init(push_decoder_data_source_t& src, const push_decoder_data_source_init_info_t& iinfo);
 void deinit(push_decoder_data_source_t& src);
 
+/**
+ * @brief drop decoded data and decode from block offset, first skip_bytes of output are dropped
+ */
+void restart(push_decoder_data_source_t& src, uint64_t block_offset, uint64_t skip_bytes);
+
+/**
+ * @brief keep chunk at block offset in cache till deinit, so restart from there doesn't wait for reading
+ */
+void pin_chunk(push_decoder_data_source_t& src, uint64_t block_offset);
+
+/**
+ * @brief apply pending restart and keep decoder fed without taking its output,
+ * so decoding goes on while frames are played from elsewhere
+ */
+void pump(push_decoder_data_source_t& src);
+
 bool read_decoded(push_decoder_data_source_t& src, uint8_t channels, uint8_t sample_byte_size,
         void* frame_out, uint64_t frame_count, uint64_t* frames_read);
 
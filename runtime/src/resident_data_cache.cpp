@@ -0,0 +1,255 @@
+#include "resident_data_cache.h"
+
+#include <cassert>
+#include <thread>
+
+#include "alloc_utils.inl"
+#include "internal/memory_utils.inl"
+
+namespace hle_audio {
+namespace rt {
+
+static const uint32_t RESIDENT_DATA_BUCKET_COUNT = 256;
+
+struct resident_data_entry_t {
+    const void* owner;
+    uint32_t file_index;
+    const void* file_owner; // data is read from its file, null once read data outlives it
+
+    // lru list, head is the most recently used
+    resident_data_entry_t* lru_prev;
+    resident_data_entry_t* lru_next;
+    resident_data_entry_t* bucket_next;
+
+    uint32_t ref_count;
+    bool orphaned; // removed from lookup, freed on last release
+
+    // data is not complete while read is in flight
+    bool reading;
+    async_read_token_t read_token;
+
+    size_t alloc_size;
+    data_buffer_t data;
+};
+
+struct resident_data_cache_t {
+    allocator_t allocator;
+    async_file_reader_t* reader;
+    size_t budget_bytes;
+
+    resident_data_entry_t* buckets[RESIDENT_DATA_BUCKET_COUNT];
+    resident_data_entry_t* lru_head;
+    resident_data_entry_t* lru_tail;
+
+    resident_data_cache_stats_t stats;
+};
+
+resident_data_cache_t* create_resident_data_cache(const resident_data_cache_create_info_t& info) {
+    auto cache = allocate<resident_data_cache_t>(info.allocator);
+    *cache = {};
+    cache->allocator = info.allocator;
+    cache->reader = info.reader;
+    cache->budget_bytes = info.budget_bytes;
+
+    return cache;
+}
+
+static void wait_read(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    if (!entry->reading) return;
+
+    while (check_request_running(cache->reader, entry->read_token)) {
+        std::this_thread::yield();
+    }
+    entry->reading = false;
+}
+
+static bool is_reading(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    if (entry->reading && !check_request_running(cache->reader, entry->read_token)) {
+        entry->reading = false;
+    }
+    return entry->reading;
+}
+
+static void free_entry(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    assert(!entry->reading && "reader still writes to entry data");
+
+    cache->stats.used_bytes -= entry->alloc_size;
+    --cache->stats.entry_count;
+
+    deallocate(cache->allocator, entry);
+}
+
+void destroy(resident_data_cache_t* cache) {
+    // banks are expected to be unloaded already
+    assert(!cache->lru_head);
+
+    deallocate(cache->allocator, cache);
+}
+
+//---------------------------------------------------------------------------------------
+// lookup
+
+static uint32_t bucket_index(const void* owner, uint32_t file_index) {
+    auto h = uint64_t(uintptr_t(owner)) * 0x9E3779B97F4A7C15ull ^ file_index * 0xC2B2AE3Du;
+    return uint32_t(h >> 32) & (RESIDENT_DATA_BUCKET_COUNT - 1);
+}
+
+static resident_data_entry_t* find(resident_data_cache_t* cache, const void* owner, uint32_t file_index) {
+    for (auto entry = cache->buckets[bucket_index(owner, file_index)]; entry; entry = entry->bucket_next) {
+        if (entry->owner == owner && entry->file_index == file_index) return entry;
+    }
+    return nullptr;
+}
+
+static void lru_unlink(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    (entry->lru_prev ? entry->lru_prev->lru_next : cache->lru_head) = entry->lru_next;
+    (entry->lru_next ? entry->lru_next->lru_prev : cache->lru_tail) = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = nullptr;
+}
+
+static void lru_push_front(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = entry;
+    cache->lru_head = entry;
+    if (!cache->lru_tail) cache->lru_tail = entry;
+}
+
+static void unlink(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    auto link = &cache->buckets[bucket_index(entry->owner, entry->file_index)];
+    while (*link != entry) link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+
+    lru_unlink(cache, entry);
+}
+
+static bool evict_to_fit(resident_data_cache_t* cache, size_t size) {
+    auto entry = cache->lru_tail;
+    while (cache->budget_bytes < cache->stats.used_bytes + size && entry) {
+        auto prev = entry->lru_prev;
+        if (!entry->ref_count && !is_reading(cache, entry)) {
+            unlink(cache, entry);
+            free_entry(cache, entry);
+        }
+        entry = prev;
+    }
+
+    return cache->stats.used_bytes + size <= cache->budget_bytes;
+}
+
+/**
+ * allocate entry and queue its read, budget is exceeded only by required data
+ */
+static resident_data_entry_t* create_entry(resident_data_cache_t* cache, const resident_data_request_t& request, bool required) {
+    auto data_offset = align_forward(sizeof(resident_data_entry_t), alignof(std::max_align_t));
+    auto alloc_size = data_offset + size_t(request.range.size);
+    if (!evict_to_fit(cache, alloc_size) && !required) return nullptr;
+
+    auto mem = (uint8_t*)allocate(cache->allocator, alloc_size, alignof(resident_data_entry_t));
+    if (!mem) return nullptr;
+
+    auto entry = new(mem) resident_data_entry_t();
+    entry->owner = request.owner;
+    entry->file_index = request.file_index;
+    entry->file_owner = request.file_owner ? request.file_owner : request.owner;
+    entry->alloc_size = alloc_size;
+    entry->data.data = mem + data_offset;
+    entry->data.size = size_t(request.range.size);
+
+    async_read_request_t read_req = {};
+    read_req.file = request.file;
+    read_req.offset = request.range.offset;
+    read_req.out_buffer = entry->data;
+    entry->read_token = request_read(cache->reader, read_req);
+    entry->reading = true;
+
+    auto& bucket = cache->buckets[bucket_index(request.owner, request.file_index)];
+    entry->bucket_next = bucket;
+    bucket = entry;
+    lru_push_front(cache, entry);
+
+    cache->stats.used_bytes += alloc_size;
+    ++cache->stats.entry_count;
+
+    return entry;
+}
+
+//---------------------------------------------------------------------------------------
+
+void preload(resident_data_cache_t* cache, const resident_data_request_t& request) {
+    auto entry = find(cache, request.owner, request.file_index);
+    if (entry) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        return;
+    }
+
+    create_entry(cache, request, false);
+}
+
+resident_data_entry_t* acquire(resident_data_cache_t* cache, const resident_data_request_t& request) {
+    auto entry = find(cache, request.owner, request.file_index);
+    if (entry) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+    } else {
+        entry = create_entry(cache, request, true);
+        if (!entry) return nullptr;
+    }
+
+    if (is_reading(cache, entry)) {
+        ++cache->stats.misses;
+    } else {
+        ++cache->stats.hits;
+    }
+
+    ++entry->ref_count;
+    return entry;
+}
+
+void release(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    assert(entry->ref_count);
+    --entry->ref_count;
+
+    if (!entry->ref_count && entry->orphaned) {
+        free_entry(cache, entry);
+    }
+}
+
+void invalidate(resident_data_cache_t* cache, const void* owner) {
+    for (auto entry = cache->lru_head; entry;) {
+        auto next = entry->lru_next;
+        if (entry->file_owner == owner) {
+            // owner file is closed after this
+            wait_read(cache, entry);
+            entry->file_owner = nullptr;
+        }
+        if (entry->owner == owner) {
+            unlink(cache, entry);
+            entry->orphaned = true;
+            if (!entry->ref_count) free_entry(cache, entry);
+        }
+        entry = next;
+    }
+}
+
+bool is_ready(resident_data_cache_t* cache, resident_data_entry_t* entry) {
+    return !is_reading(cache, entry);
+}
+
+async_read_token_t get_read_token(const resident_data_entry_t* entry) {
+    return entry->read_token;
+}
+
+const_data_buffer_t get_data(const resident_data_entry_t* entry) {
+    const_data_buffer_t res = {};
+    res.data = entry->data.data;
+    res.size = entry->data.size;
+    return res;
+}
+
+resident_data_cache_stats_t get_stats(const resident_data_cache_t* cache) {
+    return cache->stats;
+}
+
+}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "internal_alloc_types.h"
+#include "async_file_reader.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * LRU cache of resident sample data of lazily loaded banks, data is read per file with async reader.
+ * referenced entries stay loaded, unreferenced ones are evicted to fit the budget,
+ * data shared by banks is keyed by their common owner, so it's read and kept once,
+ * all functions are called from the game thread
+ */
+struct resident_data_cache_t;
+struct resident_data_entry_t;
+
+struct resident_data_cache_create_info_t {
+    allocator_t allocator;
+    async_file_reader_t* reader;
+    size_t budget_bytes;
+};
+
+struct resident_data_cache_stats_t {
+    uint32_t hits;
+    uint32_t misses; // acquires found data not read yet
+    uint32_t entry_count;
+    size_t used_bytes;
+};
+
+/**
+ * file data identity and location, owner is a bank,
+ * or owner shared by banks with file_index being data id among them, data is read from file_owner bank then
+ */
+struct resident_data_request_t {
+    const void* owner;
+    uint32_t file_index;
+    const void* file_owner; // optional, owner if not set
+
+    async_file_handle_t file;
+    stream_range_t range;
+};
+
+resident_data_cache_t* create_resident_data_cache(const resident_data_cache_create_info_t& info);
+void destroy(resident_data_cache_t* cache);
+
+/**
+ * @brief start reading data if it's not cached, so later acquire finds it ready
+ */
+void preload(resident_data_cache_t* cache, const resident_data_request_t& request);
+
+/**
+ * @brief acquire reference to data, starts reading if it's not cached, doesn't wait for the read
+ * @return nullptr if data couldn't be allocated
+ */
+resident_data_entry_t* acquire(resident_data_cache_t* cache, const resident_data_request_t& request);
+void release(resident_data_cache_t* cache, resident_data_entry_t* entry);
+
+/**
+ * drop entries of unloaded owner, referenced ones are freed on last release,
+ * waits for pending reads from owner file, shared entries read from it stay cached
+ */
+void invalidate(resident_data_cache_t* cache, const void* owner);
+
+bool is_ready(resident_data_cache_t* cache, resident_data_entry_t* entry);
+/**
+ * @brief token of entry data read, data could be used once the request isn't running
+ */
+async_read_token_t get_read_token(const resident_data_entry_t* entry);
+const_data_buffer_t get_data(const resident_data_entry_t* entry);
+
+resident_data_cache_stats_t get_stats(const resident_data_cache_t* cache);
+
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * single producer / single consumer ring positions, range size should be power of 2
+ */
+template<typename T, size_t ring_indices_range>
+struct ring_indices {
+    using indices_type = T;
+    static const size_t range_size = ring_indices_range;
+
+    std::atomic<indices_type> read_pos;
+    std::atomic<indices_type> write_pos;
+
+    void reset() {
+        read_pos = write_pos = {};
+    }
+
+    indices_type used_count() const {
+        return indices_type(write_pos.load() - read_pos.load());
+    }
+
+    bool can_write() const {
+        return write_pos.load() != indices_type(read_pos.load() + range_size);
+    }
+};
+
+/**
+ * ring_indices with range size set at runtime
+ */
+template<typename T>
+struct sized_ring_indices {
+    using indices_type = T;
+
+    std::atomic<indices_type> read_pos;
+    std::atomic<indices_type> write_pos;
+    indices_type range_size;
+
+    void reset() {
+        read_pos = write_pos = {};
+    }
+
+    indices_type used_count() const {
+        return indices_type(write_pos.load() - read_pos.load());
+    }
+
+    bool can_write() const {
+        return used_count() != range_size;
+    }
+};
+
+}
+}
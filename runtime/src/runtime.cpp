@@ -4,6 +4,9 @@
 #include <cassert>
 #include <cstdio>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 #include "miniaudio_public.h"
 
@@ -16,26 +19,32 @@
 #include "chunk_streaming_cache.h"
 #include "decoder_mp3.h"
 #include "decoder_pcm.h"
+#include "decoder_vorbis.h"
+#include "decoder_adpcm.h"
+#include "decoder_flac.h"
+#include "thread_pool.h"
 
 #include "alloc_utils.inl"
 #include "jobs_utils.inl"
 #include "file_utils.inl"
 #include "allocator_bridge.inl"
+#include "internal/memory_utils.inl"
 
 /**
  * streaming TODOs:
- *  - implement decoder_ti for ogg, etc
- *  - loop range support with decoder_ti is tricky (async decoding to start position doesn't help to maintain gapless playback)
+ *  - implement decoder_ti for other formats
+ *  - formats without frames table (vorbis) restart decoding from the file start on seek,
+ *    loop wrap is gapless only if decoding to the loop head end is faster than the head
  */
 
-using hle_audio::rt::node_state_stack_t;
 using hle_audio::rt::data_buffer_t;
+using hle_audio::rt::const_data_buffer_t;
 using hle_audio::rt::buffer_t;
 using hle_audio::rt::file_data_t;
 using hle_audio::rt::array_view_t;
 using hle_audio::rt::named_group_t;
-using hle_audio::rt::node_desc_t;
-using hle_audio::rt::node_type_e;
+using hle_audio::rt::program_op_t;
+using hle_audio::rt::program_op_e;
 using hle_audio::rt::root_header_t;
 using hle_audio::rt::event_t;
 using hle_audio::rt::action_type_e;
@@ -49,6 +58,8 @@ using hle_audio::rt::range_t;
 using hle_audio::rt::editor_runtime_t;
 using hle_audio::rt::audio_format_type_e;
 using hle_audio::rt::decoder_t;
+using hle_audio::rt::pcm_cache_key_t;
+using hle_audio::is_aligned;
 
 /////////////////////////////////////////////////////////////////////////////////////////
 
@@ -90,16 +101,12 @@ static bank_streaming_source_info_t retrieve_bank_streaming_info(hlea_context_t*
         hlea_event_bank_t* bank, uint32_t file_index) {
     
     auto buf_ptr = bank->data_buffer_ptr;
-    if (bank->static_data->file_data.count && bank->streaming_afile) {
+    if (bank->static_data->file_data.count && bank->stream_file) {
         auto& fd_ref = bank->static_data->file_data.get(buf_ptr, file_index);
 
-        range_t range = {};
-        range.offset = fd_ref.data_buffer.elements.pos;
-        range.size = fd_ref.data_buffer.count;
-
         bank_streaming_source_info_t res = {};
-        res.streaming_src = bank->streaming_cache_src;
-        res.file_range = range;
+        res.streaming_src = bank->stream_file->cache_src;
+        res.file_range = fd_ref.stream_data;
 
         return res;
     }
@@ -153,15 +160,30 @@ struct decoder_result_t {
     uint16_t dec_index;
 };
 
-static decoder_result_t acquire_decoder(hlea_context_t* ctx, audio_format_type_e audio_format) {
+static ma_format get_decoded_format(const hlea_context_t* ctx, audio_format_type_e coding_format) {
+    switch (coding_format) {
+    case audio_format_type_e::pcm:
+    case audio_format_type_e::adpcm:
+        return ma_format_s16;
+    case audio_format_type_e::mp3:
+        return ctx->mp3_s16_output ? ma_format_s16 : ma_format_f32;
+    default:
+        return ma_format_f32;
+    }
+}
+
+static decoder_result_t acquire_decoder(hlea_context_t* ctx, const file_data_t::meta_t& meta) {
     using hle_audio::rt::mp3_decoder_t;
     using hle_audio::rt::pcm_decoder_t;
+    using hle_audio::rt::vorbis_decoder_t;
+    using hle_audio::rt::adpcm_decoder_t;
+    using hle_audio::rt::flac_decoder_t;
 
     decoder_result_t res = {};
 
     // todo: ugly and bulky per type decoder storage
 
-    switch (audio_format) {
+    switch (meta.coding_format) {
     case audio_format_type_e::mp3: {
         mp3_decoder_t* mp3_dec = {};
         if (!ctx->unused_decoders_mp3_indices.empty()) {
@@ -174,37 +196,108 @@ static decoder_result_t acquire_decoder(hlea_context_t* ctx, audio_format_type_e
         } else {
             hle_audio::rt::mp3_decoder_create_info_t dec_init_info = {};
             dec_init_info.allocator = ctx->allocator;
-            dec_init_info.jobs = ctx->jobs;
+            dec_init_info.scheduler = ctx->decode_scheduler;
+            dec_init_info.aux_pool = ctx->mp3_aux_pool;
+            dec_init_info.output_ring_ms = ctx->mp3_output_ring_ms;
+            dec_init_info.s16_output = ctx->mp3_s16_output;
             mp3_dec = create_decoder(dec_init_info);
 
             res.dec_index = ctx->decoders_mp3.size;
             ctx->decoders_mp3.push_back(mp3_dec);
         }
         res.decoder = cast_to_decoder(mp3_dec);
-        res.format = ma_format_f32;
 
         break;
     }
     case audio_format_type_e::pcm: {
+        const uint32_t pcm_frame_byte_size = sizeof(int16_t) * meta.channels;
+
         pcm_decoder_t* dec_inst = {};
         if (!ctx->unused_decoders_pcm_indices.empty()) {
             auto recycled_index = ctx->unused_decoders_pcm_indices.pop_back();
             dec_inst = ctx->decoders_pcm.vec[recycled_index];
             res.dec_index = recycled_index;
 
-            reset(dec_inst);
+            reset(dec_inst, pcm_frame_byte_size);
             
         } else {
             hle_audio::rt::pcm_decoder_create_info_t dec_init_info = {};
             dec_init_info.allocator = ctx->allocator;
-            // dec_init_info.jobs = ctx->jobs;
+            dec_init_info.frame_byte_size = pcm_frame_byte_size;
+            // dec_init_info.scheduler = ctx->decode_scheduler;
             dec_inst = create_decoder(dec_init_info);
 
             res.dec_index = ctx->decoders_pcm.size;
             ctx->decoders_pcm.push_back(dec_inst);
         }
         res.decoder = cast_to_decoder(dec_inst);
-        res.format = ma_format_s16;
+
+        break;
+    }
+    case audio_format_type_e::vorbis: {
+        vorbis_decoder_t* dec_inst = {};
+        if (!ctx->unused_decoders_vorbis_indices.empty()) {
+            auto recycled_index = ctx->unused_decoders_vorbis_indices.pop_back();
+            dec_inst = ctx->decoders_vorbis.vec[recycled_index];
+            res.dec_index = recycled_index;
+
+            reset(dec_inst);
+
+        } else {
+            hle_audio::rt::vorbis_decoder_create_info_t dec_init_info = {};
+            dec_init_info.allocator = ctx->allocator;
+            dec_init_info.scheduler = ctx->decode_scheduler;
+            dec_inst = create_decoder(dec_init_info);
+
+            res.dec_index = ctx->decoders_vorbis.size;
+            ctx->decoders_vorbis.push_back(dec_inst);
+        }
+        res.decoder = cast_to_decoder(dec_inst);
+
+        break;
+    }
+    case audio_format_type_e::adpcm: {
+        adpcm_decoder_t* dec_inst = {};
+        if (!ctx->unused_decoders_adpcm_indices.empty()) {
+            auto recycled_index = ctx->unused_decoders_adpcm_indices.pop_back();
+            dec_inst = ctx->decoders_adpcm.vec[recycled_index];
+            res.dec_index = recycled_index;
+
+            reset(dec_inst, meta.channels);
+
+        } else {
+            hle_audio::rt::adpcm_decoder_create_info_t dec_init_info = {};
+            dec_init_info.allocator = ctx->allocator;
+            dec_init_info.channels = meta.channels;
+            dec_inst = create_decoder(dec_init_info);
+
+            res.dec_index = ctx->decoders_adpcm.size;
+            ctx->decoders_adpcm.push_back(dec_inst);
+        }
+        res.decoder = cast_to_decoder(dec_inst);
+
+        break;
+    }
+    case audio_format_type_e::flac: {
+        flac_decoder_t* dec_inst = {};
+        if (!ctx->unused_decoders_flac_indices.empty()) {
+            auto recycled_index = ctx->unused_decoders_flac_indices.pop_back();
+            dec_inst = ctx->decoders_flac.vec[recycled_index];
+            res.dec_index = recycled_index;
+
+            reset(dec_inst, meta.channels);
+
+        } else {
+            hle_audio::rt::flac_decoder_create_info_t dec_init_info = {};
+            dec_init_info.allocator = ctx->allocator;
+            dec_init_info.scheduler = ctx->decode_scheduler;
+            dec_init_info.channels = meta.channels;
+            dec_inst = create_decoder(dec_init_info);
+
+            res.dec_index = ctx->decoders_flac.size;
+            ctx->decoders_flac.push_back(dec_inst);
+        }
+        res.decoder = cast_to_decoder(dec_inst);
 
         break;
     }
@@ -212,6 +305,7 @@ static decoder_result_t acquire_decoder(hlea_context_t* ctx, audio_format_type_e
         assert(false && "not supported format");
         break;
     }
+    res.format = get_decoded_format(ctx, meta.coding_format);
 
     return res;
 }
@@ -228,31 +322,111 @@ static void release_decoder(hlea_context_t* ctx, audio_format_type_e audio_forma
 
         break;
     }
+    case audio_format_type_e::vorbis: {
+        ctx->unused_decoders_vorbis_indices.push_back(dec_index);
+
+        break;
+    }
+    case audio_format_type_e::adpcm: {
+        ctx->unused_decoders_adpcm_indices.push_back(dec_index);
+
+        break;
+    }
+    case audio_format_type_e::flac: {
+        ctx->unused_decoders_flac_indices.push_back(dec_index);
+
+        break;
+    }
     default:
         assert(false && "not supported format");
         break;
     }
 }
 
+static bool is_decoder_running(sound_data_t* sound) {
+    return !sound->cached_pcm && is_running(sound->decoder);
+}
+
+static void release_sound_decoding(hlea_context_t* ctx, sound_data_t* sound) {
+    if (sound->cached_pcm) {
+        release(ctx->pcm_cache, sound->cached_pcm);
+        sound->cached_pcm = nullptr;
+    } else {
+        release_decoder(ctx, sound->coding_format, sound->dec_index);
+    }
+
+    if (sound->filling_pcm) {
+        end_fill(ctx->pcm_cache, sound->filling_pcm);
+        sound->filling_pcm = nullptr;
+    }
+
+    if (sound->resident_data) {
+        release(ctx->resident_data_cache, sound->resident_data);
+        sound->resident_data = nullptr;
+    }
+}
+
+static hle_audio::rt::frame_seek_info_t resolve_seek_info(const file_data_t& fd_ref, buffer_t buf_ptr) {
+    hle_audio::rt::frame_seek_info_t res = {};
+    if (fd_ref.seek_table.frame_offsets.count) {
+        auto& seek_table = fd_ref.seek_table;
+        res.frame_offsets = seek_table.frame_offsets.elements.get_ptr(buf_ptr);
+        res.entry_count = seek_table.frame_offsets.count;
+        res.samples_per_frame = seek_table.samples_per_frame;
+        res.frames_per_entry = seek_table.frames_per_entry;
+    }
+    return res;
+}
+
+/**
+ * restarted decoder output is ready after the period being played, the period till
+ * scheduler starts decoding job (on period processing) and the period job takes
+ */
+static uint32_t get_decoder_restart_latency_ms(hlea_context_t* ctx) {
+    auto device = ma_engine_get_device(&ctx->engine);
+    if (!device || !device->playback.internalSampleRate) return 0;
+
+    auto period_frames = device->playback.internalPeriodSizeInFrames;
+    return 3 * (period_frames * 1000 + device->playback.internalSampleRate - 1) / device->playback.internalSampleRate;
+}
+
+/**
+ * resident data identity, data of banks built with shared stream file is identified by its content id there,
+ * the id is assigned by the tool to equal data, so such banks share cached data
+ */
+static pcm_cache_key_t get_resident_data_key(const hlea_event_bank_t* bank, uint32_t file_index) {
+    auto& fd_ref = bank->static_data->file_data.get(bank->data_buffer_ptr, file_index);
+    if (fd_ref.content_id && bank->stream_file) {
+        return {bank->stream_file, fd_ref.content_id};
+    }
+    return {bank, file_index};
+}
+
+static hle_audio::rt::resident_data_request_t make_resident_data_request(const hlea_event_bank_t* bank, uint32_t file_index) {
+    auto& fd_ref = bank->static_data->file_data.get(bank->data_buffer_ptr, file_index);
+    auto key = get_resident_data_key(bank, file_index);
+
+    hle_audio::rt::resident_data_request_t res = {};
+    res.owner = key.owner;
+    res.file_index = key.file_index;
+    res.file_owner = bank;
+    res.file = bank->data_afile;
+    res.range.offset = fd_ref.data_buffer.elements.pos;
+    res.range.size = fd_ref.data_buffer.count;
+    return res;
+}
+
 static sound_id_t make_sound(hlea_context_t* ctx, 
         hlea_event_bank_t* bank, uint8_t output_bus_index,
-        const hle_audio::rt::file_node_t* file_node) {
+        uint32_t file_index, bool loop) {
     const sound_id_t invalid_id = (sound_id_t)0u;
 
-    const ma_uint32 sound_flags = MA_SOUND_FLAG_NO_SPATIALIZATION;
-
     auto buf_ptr = bank->data_buffer_ptr;
 
     assert(bank->static_data->file_data.count);
-    auto& fd_ref = bank->static_data->file_data.get(buf_ptr, file_node->file_index);
+    auto& fd_ref = bank->static_data->file_data.get(buf_ptr, file_index);
     file_data_t::meta_t meta = fd_ref.meta;
 
-    data_buffer_t buffer_data = {};
-    if (fd_ref.data_buffer.count) {
-        buffer_data.data = (uint8_t*)fd_ref.data_buffer.elements.get_ptr(buf_ptr); // todo: void* cast, but read only here
-        buffer_data.size = fd_ref.data_buffer.count;
-    }
-
     sound_data_t* sound = nullptr;
     auto sound_id = acquire_sound(ctx, &sound);
     if (!sound_id) {
@@ -260,7 +434,42 @@ static sound_id_t make_sound(hlea_context_t* ctx,
         return invalid_id;
     }
 
-    auto dec_data = acquire_decoder(ctx, meta.coding_format);
+    data_buffer_t buffer_data = {};
+    bool buffer_data_pending = false;
+    if (fd_ref.data_buffer.count) {
+        if (bank->data_afile) {
+            sound->resident_data = acquire(ctx->resident_data_cache, make_resident_data_request(bank, file_index));
+            if (sound->resident_data) {
+                auto data = get_data(sound->resident_data);
+                buffer_data.data = const_cast<uint8_t*>(data.data); // read only
+                buffer_data.size = data.size;
+                // not waited here, buffer source starts decoding once it's read
+                buffer_data_pending = !is_ready(ctx->resident_data_cache, sound->resident_data);
+            }
+        } else {
+            buffer_data.data = (uint8_t*)fd_ref.data_buffer.elements.get_ptr(buf_ptr); // todo: void* cast, but read only here
+            buffer_data.size = fd_ref.data_buffer.count;
+        }
+    }
+
+    // short resident compressed sounds are decoded once and shared through pcm cache
+    const pcm_cache_key_t cache_key = get_resident_data_key(bank, file_index);
+    bool use_pcm_cache = ctx->pcm_cache && !meta.stream && buffer_data.data &&
+        meta.coding_format != audio_format_type_e::pcm &&
+        is_cacheable(ctx->pcm_cache, get_decoded_format(ctx, meta.coding_format), meta.channels, meta.length_in_samples);
+    if (use_pcm_cache) {
+        sound->cached_pcm = acquire(ctx->pcm_cache, cache_key);
+    }
+
+    decoder_result_t dec_data = {};
+    if (sound->cached_pcm) {
+        dec_data.format = get_decoded_format(ctx, meta.coding_format);
+    } else {
+        dec_data = acquire_decoder(ctx, meta);
+        if (use_pcm_cache) {
+            sound->filling_pcm = begin_fill(ctx->pcm_cache, cache_key, dec_data.format, meta.channels, meta.length_in_samples);
+        }
+    }
     sound->decoder = dec_data.decoder;
     sound->coding_format = meta.coding_format;
     sound->dec_index = dec_data.dec_index;
@@ -268,7 +477,7 @@ static sound_id_t make_sound(hlea_context_t* ctx,
     if (meta.stream) {
         streaming_data_source_t* str_src = acquire_streaming_data_source(ctx);
         if (str_src) {
-            auto streaming_info = retrieve_bank_streaming_info(ctx, bank, file_node->file_index);
+            auto streaming_info = retrieve_bank_streaming_info(ctx, bank, file_index);
             if (streaming_info.streaming_src) {
                 streaming_data_source_init_info_t info = {};
                 auto& dec_info = info.decoder_reader_info;
@@ -277,22 +486,30 @@ static sound_id_t make_sound(hlea_context_t* ctx,
                 dec_info.input_src = streaming_info.streaming_src;
                 dec_info.buffer_block = streaming_info.file_range;
                 dec_info.decoder = dec_data.decoder;
+                if (fd_ref.stream_head.count) {
+                    dec_info.head.data = fd_ref.stream_head.elements.get_ptr(buf_ptr);
+                    dec_info.head.size = size_t(std::min<uint64_t>(fd_ref.stream_head.count, streaming_info.file_range.size));
+                }
 
                 info.format = dec_data.format;
                 info.meta = meta;
+                info.seek_info = resolve_seek_info(fd_ref, buf_ptr);
+                info.allocator = ctx->allocator;
+                info.loop = loop;
+                info.min_loop_head_ms = get_decoder_restart_latency_ms(ctx);
 
                 auto result = streaming_data_source_init(str_src, info);
                 if (result == MA_SUCCESS) {
                     sound->str_src = str_src;
 
-                    result = ma_sound_init_from_data_source(&ctx->engine, 
-                        str_src,
-                        sound_flags, 
-                        &ctx->output_bus_groups[output_bus_index], 
-                        &sound->engine_sound);
+                    // setup loop point
+                    if (meta.loop_end) {
+                        ma_data_source_set_loop_point_in_pcm_frames(str_src, meta.loop_start, meta.loop_end);
+                    }
 
-                    if (result == MA_SUCCESS) {
-                        ma_sound_set_looping(&sound->engine_sound, file_node->loop);
+                    sound->voice = acquire_voice(ctx->voice_pool, output_bus_index, str_src);
+                    if (sound->voice) {
+                        ma_sound_set_looping(&sound->voice->sound, loop);
 
                         return sound_id;
                     }
@@ -315,6 +532,15 @@ static sound_id_t make_sound(hlea_context_t* ctx,
             info.format = dec_data.format;
             info.meta = meta;
             info.buffer = buffer_data;
+            info.seek_info = resolve_seek_info(fd_ref, buf_ptr);
+            if (sound->cached_pcm) {
+                info.decoded_frames = get_frames(sound->cached_pcm);
+            }
+            info.fill_entry = sound->filling_pcm;
+            if (buffer_data_pending) {
+                info.input_reader = ctx->async_io;
+                info.input_read_token = get_read_token(sound->resident_data);
+            }
             auto result = buffer_data_source_init(src, info);
             if (result == MA_SUCCESS) {
                 sound->buffer_src = src;
@@ -324,14 +550,10 @@ static sound_id_t make_sound(hlea_context_t* ctx,
                     ma_data_source_set_loop_point_in_pcm_frames(src, meta.loop_start, meta.loop_end);
                 }
 
-                // Init sound
-                result = ma_sound_init_from_data_source(&ctx->engine, 
-                        src,
-                        sound_flags, 
-                        &ctx->output_bus_groups[output_bus_index], 
-                        &sound->engine_sound);
-                if (result == MA_SUCCESS) {
-                    ma_sound_set_looping(&sound->engine_sound, file_node->loop);
+                // bind pooled voice
+                sound->voice = acquire_voice(ctx->voice_pool, output_bus_index, src);
+                if (sound->voice) {
+                    ma_sound_set_looping(&sound->voice->sound, loop);
                 
                     return sound_id;
                 }
@@ -343,17 +565,12 @@ static sound_id_t make_sound(hlea_context_t* ctx,
         }
     }
 
-    release_decoder(ctx, meta.coding_format, dec_data.dec_index);
+    release_sound_decoding(ctx, sound);
 
     release_sound(ctx, sound_id);
     return invalid_id;
 }
 
-template<typename T>
-constexpr memory_layout_t static_type_layout() {
-    return {sizeof(T), alignof(T)};
-}
-
 template<typename T>
 static const T* bank_get(const hlea_event_bank_t* bank, 
         const array_view_t<T> arr, size_t index) {
@@ -365,112 +582,46 @@ static const named_group_t* bank_get_group(const hlea_event_bank_t* bank, uint32
     return bank_get(bank, bank->static_data->groups, group_index);
 }
 
-static node_desc_t sequence_process_node(const hlea_event_bank_t* bank, const node_desc_t& node_desc, void* state) {
-    auto s = (sequence_rt_state_t*)state;
-    
-    auto seq_node = bank_get(bank, bank->static_data->nodes_sequence, node_desc.index);
-
-    auto seq_size = seq_node->nodes.count;
-    if (seq_size <= s->current_index) return {};
-
-    auto res = seq_node->nodes.get(bank->data_buffer_ptr, s->current_index);
-
-    // update state
-    ++s->current_index;
-
-    return res;
-}
-
-static node_desc_t repeat_process_node(const hlea_event_bank_t* bank, const node_desc_t& node_desc, void* state) {
-    auto s = (repeat_rt_state_t*)state;
-        
-    auto repeat_node = bank_get(bank, bank->static_data->nodes_repeat, node_desc.index);
-
-    if (repeat_node->repeat_count && repeat_node->repeat_count <= s->iteration_counter) return {};
-
-    auto res = repeat_node->node;
-
-    // update state
-    ++s->iteration_counter;
-
-    return res;
-}
-
-static node_desc_t random_process_node(const hlea_event_bank_t* bank, const node_desc_t& node_desc, void* /*state*/) {
-    auto random_node = bank_get(bank, bank->static_data->nodes_random, node_desc.index);
-    int random_index = rand() % random_node->nodes.count;
-    return random_node->nodes.get(bank->data_buffer_ptr, random_index);
-}
-
-struct node_funcs_t {
-    memory_layout_t state_mem_layout;
-
-    node_desc_t (*process_func)(const hlea_event_bank_t* bank, const node_desc_t& node_desc, void* state);
-};
-
-static const node_funcs_t g_node_handlers[] = {
-    {}, // None
-    {}, // File
-    {{}, random_process_node}, // Random
-    {static_type_layout<sequence_rt_state_t>(), sequence_process_node}, // Sequence
-    {static_type_layout<repeat_rt_state_t>(), repeat_process_node}, // Repeat
-};
-
-static node_desc_t process_node(const hlea_event_bank_t* bank, const node_desc_t& node_desc, void* state) {
-    auto process_func = g_node_handlers[size_t(node_desc.type)].process_func;
-    if (process_func) {
-        return process_func(bank, node_desc, state);
-    }
-
-    return {};
-}
-
-static bool init_and_push_state(node_state_stack_t& stack, const node_desc_t& node_desc) {
-    memory_layout_t layout = g_node_handlers[size_t(node_desc.type)].state_mem_layout;
-    if (layout.size) {
-        push_state(stack, node_desc, layout);
-        // init state memory, (implement init func for something fancy)
-
-        return true;
-    }
-    return false;
-}
-
-static node_desc_t next_node_statefull(node_state_stack_t& stack, const hlea_event_bank_t* bank) {
-    node_desc_t next_node_desc = {};
-    while (next_node_desc.type == node_type_e::None && !is_empty(stack)) {
-        next_node_desc = process_node(bank, top_node_desc(stack), top_state(stack));
-        if (next_node_desc.type == node_type_e::None) pop_up_state(stack);
-    }
-
-    return next_node_desc;
-}
-
+/**
+ * run group program till next play op, invalid_sound_id once program is finished
+ */
 static sound_id_t make_next_sound(hlea_context_t* ctx, group_data_t& group) {
     auto group_sdata = bank_get_group(group.bank, group.group_index);
 
-    node_desc_t next_node_desc = {};
-    
-    if (is_empty(group.state_stack)) {
-        // first run
-        next_node_desc = group_sdata->node;
-    } else {
-        next_node_desc = next_node_statefull(group.state_stack, group.bank);
-    }
-
-    while(next_node_desc.type != node_type_e::None) {
-        // sound node found, interupt traversing, generate sound
-        if (next_node_desc.type == node_type_e::File) {
-            auto file_node = bank_get(group.bank, group.bank->static_data->nodes_file, next_node_desc.index);
-            return make_sound(ctx, group.bank, group_sdata->output_bus_index, file_node);
+    auto& program = group_sdata->program;
+    if (program.count <= group.program_pc) return invalid_sound_id;
+
+    auto ops = program.elements.get_ptr(group.bank->data_buffer_ptr);
+    while (group.program_pc < program.count) {
+        auto& op = ops[group.program_pc++];
+        switch (op.type)
+        {
+        case program_op_e::play:
+        case program_op_e::play_loop: {
+            // sound op found, interupt program, generate sound
+            bool loop = op.type == program_op_e::play_loop;
+            return make_sound(ctx, group.bank, group_sdata->output_bus_index, op.arg, loop);
+        }
+        case program_op_e::random: {
+            // land on one of following jumps, non zero choice count is validated on load
+            assert(op.arg);
+            group.program_pc += rand() % op.arg;
+            break;
+        }
+        case program_op_e::jump: {
+            group.program_pc = op.arg;
+            break;
+        }
+        case program_op_e::loop_next: {
+            auto& counter = group.loop_counters[op.slot];
+            if (++counter < op.count) {
+                group.program_pc = op.arg;
+            } else {
+                // nested loop is entered again from zero
+                counter = 0;
+            }
+            break;
         }
-
-        if (init_and_push_state(group.state_stack, next_node_desc)) {
-            // use stacked node
-            next_node_desc = next_node_statefull(group.state_stack, group.bank);
-        } else {
-            // stateless
-            next_node_desc = process_node(group.bank, next_node_desc, nullptr);
         }
     }
 
@@ -482,7 +633,7 @@ static void start_next_after_current(hlea_context_t* ctx, group_data_t& group) {
     if (!group.next_sound_id) return;
 
     auto sound_data_ptr = get_sound_data(ctx, group.sound_id);
-    auto sound = &sound_data_ptr->engine_sound;
+    auto sound = &sound_data_ptr->voice->sound;
     if (ma_sound_is_looping(sound)) return;
     
     auto engine_rate = ma_engine_get_sample_rate(&ctx->engine);
@@ -504,7 +655,7 @@ static void start_next_after_current(hlea_context_t* ctx, group_data_t& group) {
     auto fade_time_pcm = (ma_uint64)(group_data->cross_fade_time * engine_rate);
 
     auto next_sound_data_ptr = get_sound_data(ctx, group.next_sound_id);
-    auto next_sound = &next_sound_data_ptr->engine_sound;
+    auto next_sound = &next_sound_data_ptr->voice->sound;
     if (fade_time_pcm) {
         ma_sound_set_fade_in_pcm_frames(next_sound, -1, 1, fade_time_pcm);
     }
@@ -522,35 +673,106 @@ static void start_next_after_current(hlea_context_t* ctx, group_data_t& group) {
 static void group_make_next_sound(hlea_context_t* ctx, group_data_t& group) {
     group.next_sound_id = invalid_sound_id;
 
-    // no state left, leave
-    if (is_empty(group.state_stack)) return;
-
     group.next_sound_id = make_next_sound(ctx, group);
     if (!group.next_sound_id) return;
     
     auto group_data = bank_get_group(group.bank, group.group_index);
 
     auto next_sound_data_ptr = get_sound_data(ctx, group.next_sound_id);
-    ma_sound_set_volume(&next_sound_data_ptr->engine_sound, group_data->volume);
+    ma_sound_set_volume(&next_sound_data_ptr->voice->sound, group_data->volume);
 
     start_next_after_current(ctx, group);
 }
 
-static void group_play(hlea_context_t* ctx, const event_desc_t* desc) {
-    if (ctx->active_groups_size == MAX_ACTIVE_GROUPS) return;
-
-    group_data_t group = {};
+static void group_init(group_data_t& group, const event_desc_t* desc) {
+    group = {};
     group.bank = desc->bank;
     group.group_index = desc->target_index;
     group.obj_id = desc->obj_id;
-    // todo: use pooled allocator instead of general one
-    // todo: control size
-    init(group.state_stack, 128, ctx->allocator);
+}
+
+/**
+ * decode streamed sound start ahead, true if sound could start without waiting for data
+ */
+static bool prefetch_sound(hlea_context_t* ctx, sound_id_t sound_id) {
+    auto sound = get_sound_data(ctx, sound_id);
+    if (!sound->str_src) return true;
+
+    auto frame_count = ma_uint64(sound->str_src->sample_rate) * ctx->prepare_ms / 1000;
+    return streaming_data_source_prefetch(sound->str_src, frame_count);
+}
+
+static uint8_t find_prepared_group_index(hlea_context_t* ctx, const event_desc_t* desc) {
+    uint8_t index = 0u;
+    for (; index < ctx->prepared_groups.size; ++index) {
+        auto& group = ctx->prepared_groups.vec[index];
+
+        if (group.bank == desc->bank &&
+            group.group_index == desc->target_index &&
+            group.obj_id == desc->obj_id) {
+            break;
+        }
+    }
+    return index;
+}
+
+static void uninit_and_release_sound(hlea_context_t* ctx, sound_id_t sound_id);
+
+static void group_prepared_release(hlea_context_t* ctx, uint8_t prepared_index) {
+    group_data_t& group = ctx->prepared_groups.vec[prepared_index];
+
+    uninit_and_release_sound(ctx, group.sound_id);
+
+    ctx->prepared_groups.swap_remove(prepared_index);
+}
+
+static void group_prepare(hlea_context_t* ctx, const event_desc_t* desc) {
+    if (ctx->prepared_groups.is_full()) return;
+    if (find_prepared_group_index(ctx, desc) < ctx->prepared_groups.size) return;
+
+    group_data_t group;
+    group_init(group, desc);
 
     group.sound_id = make_next_sound(ctx, group);
+    if (!group.sound_id) return;
+
+    // start reading right away, the rest is decoded in hlea_process_frame
+    prefetch_sound(ctx, group.sound_id);
+
+    ctx->prepared_groups.push_back(group);
+}
+
+static void process_prepared_groups(hlea_context_t* ctx) {
+    for (uint8_t i = 0; i < ctx->prepared_groups.size; ++i) {
+        prefetch_sound(ctx, ctx->prepared_groups.vec[i].sound_id);
+    }
+}
+
+static void group_play(hlea_context_t* ctx, const event_desc_t* desc) {
+    if (ctx->active_groups_size == MAX_ACTIVE_GROUPS) return;
+
+    group_data_t group;
+    bool prepared = false;
+
+    auto prepared_index = find_prepared_group_index(ctx, desc);
+    if (prepared_index < ctx->prepared_groups.size) {
+        group = ctx->prepared_groups.vec[prepared_index];
+        ctx->prepared_groups.swap_remove(prepared_index);
+
+        prepared = prefetch_sound(ctx, group.sound_id);
+    } else {
+        group_init(group, desc);
+        group.sound_id = make_next_sound(ctx, group);
+    }
+
     if (group.sound_id) {
         auto sound_data_ptr = get_sound_data(ctx, group.sound_id);
-        auto sound = &sound_data_ptr->engine_sound;
+        auto sound = &sound_data_ptr->voice->sound;
+
+        if (sound_data_ptr->str_src) {
+            if (prepared) ++ctx->prepared_start_count;
+            else ++ctx->cold_start_count;
+        }
 
         auto group_data = bank_get_group(desc->bank, desc->target_index);
 
@@ -595,18 +817,18 @@ static void sound_fade_and_stop(hlea_context_t* ctx, sound_id_t sound_id, ma_uin
     auto sound_data = get_sound_data(ctx, sound_id);
 
     // just stop if not playing (could have delayed start, so need to stop explicitly)
-    if (!ma_sound_is_playing(&sound_data->engine_sound)) {
-        ma_sound_stop(&sound_data->engine_sound);
+    if (!ma_sound_is_playing(&sound_data->voice->sound)) {
+        ma_sound_stop(&sound_data->voice->sound);
         return;
     }
 
     // schedule fade
-    ma_sound_set_fade_in_pcm_frames(&sound_data->engine_sound, -1, 0, fade_time_pcm);
+    ma_sound_set_fade_in_pcm_frames(&sound_data->voice->sound, -1, 0, fade_time_pcm);
     
     // schedule stop
-    auto engine = ma_sound_get_engine(&sound_data->engine_sound);
+    auto engine = ma_sound_get_engine(&sound_data->voice->sound);
     auto engine_time = ma_engine_get_time(engine);
-    ma_sound_set_stop_time_in_pcm_frames(&sound_data->engine_sound, engine_time + fade_time_pcm);
+    ma_sound_set_stop_time_in_pcm_frames(&sound_data->voice->sound, engine_time + fade_time_pcm);
 }
 
 static void group_active_stop_with_fade(hlea_context_t* ctx, group_data_t& group, float fade_time) {
@@ -621,6 +843,12 @@ static void group_active_stop_with_fade(hlea_context_t* ctx, group_data_t& group
 }
 
 static void group_stop(hlea_context_t* ctx, const event_desc_t* desc) {
+    // stop cancels not yet played prepare too
+    auto prepared_index = find_prepared_group_index(ctx, desc);
+    if (prepared_index < ctx->prepared_groups.size) {
+        group_prepared_release(ctx, prepared_index);
+    }
+
     auto active_index = find_active_group_index(ctx, desc);
 
     if (active_index == ctx->active_groups_size) return;
@@ -652,7 +880,7 @@ static void sound_start_with_fade(hlea_context_t* ctx, sound_id_t sound_id, ma_u
     if (!sound_id) return;
 
     auto sound_data = get_sound_data(ctx, sound_id);
-    auto sound = &sound_data->engine_sound;
+    auto sound = &sound_data->voice->sound;
 
     // finished, nothing to resume
     if (ma_sound_at_end(sound)) return;
@@ -729,7 +957,7 @@ static void group_break_loop(hlea_context_t* ctx, const event_desc_t* desc) {
 
     group_data_t& group = ctx->active_groups[active_index];
     auto sound_data_ptr = get_sound_data(ctx, group.sound_id);
-    ma_sound_set_looping(&sound_data_ptr->engine_sound, false);
+    ma_sound_set_looping(&sound_data_ptr->voice->sound, false);
     
     start_next_after_current(ctx, group);
 }
@@ -748,59 +976,128 @@ static void release_sound_data(hlea_context_t* ctx, sound_id_t sound_id) {
         sound_data_ptr->buffer_src = nullptr;
     }
 
-    release_decoder(ctx, sound_data_ptr->coding_format, sound_data_ptr->dec_index);
+    release_sound_decoding(ctx, sound_data_ptr);
 
     release_sound(ctx, sound_id);
 }
 
-static void uninit_and_release_sound(hlea_context_t* ctx, sound_id_t sound_id) {
+// called from job thread or from stop itself
+static void sound_decoder_stopped(void* udata) {
+    auto notify = (sound_stop_notify_t*)udata;
+    auto ctx = notify->ctx;
+
+    ma_spinlock_lock(&ctx->stopped_sounds_lock);
+    assert(ctx->stopped_sounds_size < MAX_SOUNDS);
+    ctx->stopped_sounds[ctx->stopped_sounds_size++] = notify->sound_id;
+    ma_spinlock_unlock(&ctx->stopped_sounds_lock);
+}
+
+static uint32_t get_audio_period(hlea_context_t* ctx) {
+    return ctx->decode_tick_node.period_counter.load(std::memory_order_acquire);
+}
+
+static bool is_audio_thread_running(hlea_context_t* ctx) {
+    return ma_device_get_state(ma_engine_get_device(&ctx->engine)) == ma_device_state_started;
+}
+
+/**
+ * audio period in progress on stop could still read the voice, 
+ * the one after the next counted is started after stop for sure
+ */
+static bool is_retired(hlea_context_t* ctx, const retiring_sound_t& retiring) {
+    return RETIRE_PERIOD_COUNT <= get_audio_period(ctx) - retiring.period || !is_audio_thread_running(ctx);
+}
+
+static void finish_release_sound(hlea_context_t* ctx, sound_id_t sound_id) {
     auto sound_data_ptr = get_sound_data(ctx, sound_id);
-    
-    ma_sound_uninit(&sound_data_ptr->engine_sound);
 
-    // defer uninit if decoder is not finished
-    if(is_running(sound_data_ptr->decoder)) {
-        assert(ctx->pending_sounds_size < (sizeof(ctx->pending_sounds) / sizeof(ctx->pending_sounds[0])));
-        ctx->pending_sounds[ctx->pending_sounds_size++] = sound_id;
+    // audio thread is done with the voice, reuse it
+    release_voice(ctx->voice_pool, sound_data_ptr->voice);
+    sound_data_ptr->voice = nullptr;
+
+    // defer uninit till decoder job is stopped, it's done between frames
+    if(is_decoder_running(sound_data_ptr)) {
+        sound_data_ptr->stop_notify.ctx = ctx;
+        sound_data_ptr->stop_notify.sound_id = sound_id;
+        ++ctx->stopping_sounds_count;
+        stop(sound_data_ptr->decoder, sound_decoder_stopped, &sound_data_ptr->stop_notify);
         return;
     }
 
     release_sound_data(ctx, sound_id);
 }
 
-static void group_active_release(hlea_context_t* ctx, uint32_t active_index) {
-    group_data_t& group = ctx->active_groups[active_index];
+static void uninit_and_release_sound(hlea_context_t* ctx, sound_id_t sound_id) {
+    auto sound_data_ptr = get_sound_data(ctx, sound_id);
+
+    // voice stays attached to its bus, no node graph locking here
+    ma_sound_stop(&sound_data_ptr->voice->sound);
 
-    // clean up state data
-    deinit(group.state_stack);
+    retiring_sound_t retiring = {};
+    retiring.sound_id = sound_id;
+    retiring.period = get_audio_period(ctx);
 
+    assert(ctx->retiring_sounds_size < MAX_SOUNDS);
+    ctx->retiring_sounds[ctx->retiring_sounds_size++] = retiring;
+}
+
+static void process_retiring_sounds(hlea_context_t* ctx) {
+    uint16_t keep_count = 0;
+    for (uint16_t i = 0; i < ctx->retiring_sounds_size; ++i) {
+        auto& retiring = ctx->retiring_sounds[i];
+        if (is_retired(ctx, retiring)) {
+            finish_release_sound(ctx, retiring.sound_id);
+        } else {
+            ctx->retiring_sounds[keep_count++] = retiring;
+        }
+    }
+    ctx->retiring_sounds_size = keep_count;
+}
+
+/**
+ * wait for the audio thread to leave all stopped voices, their sources could be released right after
+ */
+static void flush_retiring_sounds(hlea_context_t* ctx) {
+    while (ctx->retiring_sounds_size) {
+        process_retiring_sounds(ctx);
+        if (ctx->retiring_sounds_size) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+static void group_active_release(hlea_context_t* ctx, uint32_t active_index) {
     // swap remove
     ctx->active_groups[active_index] = ctx->active_groups[ctx->active_groups_size - 1];
     --ctx->active_groups_size;
 }
 
-static ma_result task_executor_job_process(ma_job* pJob) {
-    hlea_job_t job = {};
-    job.job_func = (decltype(job.job_func))pJob->data.custom.data0;
-    job.udata = (decltype(job.udata))pJob->data.custom.data1;
+// ~100ms of 48khz audio
+static const uint16_t DEFAULT_MP3_OUTPUT_RING_MS = 100;
+static const uint32_t MP3_AUX_BLOCK_SIZE = 16 * 1024;
+static const uint32_t MP3_AUX_INITIAL_BLOCK_COUNT = 4;
 
-    job.job_func(job.udata);
+static const uint16_t DEFAULT_PREWARM_VOICE_COUNT = 4;
 
-    return MA_SUCCESS;
-}
+// few frames of slow storage reads
+static const uint16_t DEFAULT_PREPARE_MS = 200;
 
-static void task_executor_launch(void* udata, hlea_job_t job) {
-    auto executor = (ma_device_job_thread*)udata;
+static const uint32_t DEFAULT_PCM_CACHE_BUDGET = 8 * 1024 * 1024;
+// ~1.5s of 44.1khz stereo f32
+static const uint32_t DEFAULT_PCM_CACHE_MAX_ENTRY_SIZE = 512 * 1024;
 
-    auto ma_job = ma_job_init(MA_JOB_TYPE_CUSTOM);
-    ma_job.data.custom.proc = task_executor_job_process;
-    ma_job.data.custom.data0 = (ma_uintptr)job.job_func;
-    ma_job.data.custom.data1 = (ma_uintptr)job.udata;
-    auto result = ma_device_job_thread_post(executor, &ma_job);
+static void decode_tick_node_process(ma_node* pNode, const float** /*ppFramesIn*/, ma_uint32* /*pFrameCountIn*/, float** /*ppFramesOut*/, ma_uint32* /*pFrameCountOut*/) {
+    auto node = (decode_tick_node_t*)pNode;
+    process_period(node->scheduler);
+    node->period_counter.fetch_add(1, std::memory_order_release);
 }
 
-static const hlea_jobs_ti s_task_executor_jobs_vt {
-    task_executor_launch
+static ma_node_vtable g_decode_tick_node_vtable = {
+    decode_tick_node_process,
+    nullptr,
+    0, // inputs
+    1, // outputs
+    MA_NODE_FLAG_CONTINUOUS_PROCESSING | MA_NODE_FLAG_SILENT_OUTPUT
 };
 
 hlea_context_t* hlea_create(hlea_context_create_info_t* info) {
@@ -811,7 +1108,7 @@ hlea_context_t* hlea_create(hlea_context_create_info_t* info) {
     }
 
     auto ctx = allocate_unique<hlea_context_t>(alloc);
-    memset(ctx.get(), 0, sizeof(hlea_context_t));
+    new(ctx.get()) hlea_context_t(); // zeroed, atomics are value initialized
     ctx->allocator = alloc;
 
     auto allocation_callbacks = make_allocation_callbacks(&ctx->allocator);
@@ -839,6 +1136,14 @@ hlea_context_t* hlea_create(hlea_context_create_info_t* info) {
         // todo: check results, deinit, return nullptr
         result = ma_sound_group_init(&ctx->engine, 0, nullptr, &ctx->output_bus_groups[i]);
     }
+
+    hle_audio::rt::voice_pool_create_info_t voice_pool_info = {};
+    voice_pool_info.allocator = ctx->allocator;
+    voice_pool_info.engine = &ctx->engine;
+    voice_pool_info.buses = ctx->output_bus_groups;
+    voice_pool_info.bus_count = ctx->output_bus_group_count;
+    voice_pool_info.prewarm_count = info->prewarm_voice_count ? info->prewarm_voice_count : DEFAULT_PREWARM_VOICE_COUNT;
+    ctx->voice_pool = hle_audio::rt::create_voice_pool(voice_pool_info);
     
     if (info->jobs_vt) {
         jobs_t jobs_impl = {};
@@ -847,15 +1152,33 @@ hlea_context_t* hlea_create(hlea_context_create_info_t* info) {
         
         ctx->jobs = jobs_impl;
     } else {
-        // init single thread pool as default job processor
-        auto jobThreadConfig = ma_device_job_thread_config_init();
-        ma_device_job_thread_init(&jobThreadConfig, &config.allocationCallbacks, &ctx->task_executor);
+        // init work-stealing pool as default job processor
+        hle_audio::rt::thread_pool_create_info_t pool_info = {};
+        pool_info.allocator = ctx->allocator;
+        pool_info.worker_count = info->job_worker_count;
+        pool_info.pin_workers = info->pin_job_workers;
+        ctx->thread_pool = hle_audio::rt::create_thread_pool(pool_info);
+
+        ctx->jobs = get_jobs(ctx->thread_pool);
+    }
 
-        jobs_t jobs_impl = {};
-        jobs_impl.vt = &s_task_executor_jobs_vt;
-        jobs_impl.udata = &ctx->task_executor;
-        
-        ctx->jobs = jobs_impl;
+    hle_audio::rt::decode_scheduler_create_info_t sched_info = {};
+    sched_info.allocator = ctx->allocator;
+    sched_info.jobs = ctx->jobs;
+    sched_info.batch_count = info->decode_batch_count;
+    ctx->decode_scheduler = hle_audio::rt::create_decode_scheduler(sched_info);
+
+    // tick scheduler from the audio thread
+    {
+        ma_uint32 channels = ma_engine_get_channels(&ctx->engine);
+        auto node_config = ma_node_config_init();
+        node_config.vtable = &g_decode_tick_node_vtable;
+        node_config.pOutputChannels = &channels;
+
+        ctx->decode_tick_node.scheduler = ctx->decode_scheduler;
+        // todo: check results
+        result = ma_node_init(ma_engine_get_node_graph(&ctx->engine), &node_config, &allocation_callbacks, &ctx->decode_tick_node);
+        result = ma_node_attach_output_bus(&ctx->decode_tick_node, 0, ma_engine_get_endpoint(&ctx->engine), 0);
     }
 
     hle_audio::rt::async_file_reader_create_info_t cinfo = {};
@@ -868,6 +1191,35 @@ hlea_context_t* hlea_create(hlea_context_create_info_t* info) {
     cache_iinfo.async_io = ctx->async_io;
     ctx->streaming_cache = hle_audio::rt::create_cache(cache_iinfo);
 
+    if (!info->disable_pcm_cache) {
+        hle_audio::rt::pcm_cache_create_info_t pcm_cache_info = {};
+        pcm_cache_info.allocator = ctx->allocator;
+        pcm_cache_info.budget_bytes = info->pcm_cache_budget ? info->pcm_cache_budget : DEFAULT_PCM_CACHE_BUDGET;
+        pcm_cache_info.max_entry_bytes = info->pcm_cache_max_entry_size ? info->pcm_cache_max_entry_size : DEFAULT_PCM_CACHE_MAX_ENTRY_SIZE;
+        ctx->pcm_cache = hle_audio::rt::create_pcm_cache(pcm_cache_info);
+    }
+
+    if (info->resident_data_budget) {
+        hle_audio::rt::resident_data_cache_create_info_t resident_info = {};
+        resident_info.allocator = ctx->allocator;
+        resident_info.reader = ctx->async_io;
+        resident_info.budget_bytes = info->resident_data_budget;
+        ctx->resident_data_cache = hle_audio::rt::create_resident_data_cache(resident_info);
+    }
+
+    // mapping goes around file api, so use it only when default one is used
+    ctx->use_mapped_streaming = info->use_mapped_streaming && !info->file_api_vt;
+    ctx->mp3_output_ring_ms = info->mp3_output_ring_ms ? info->mp3_output_ring_ms : DEFAULT_MP3_OUTPUT_RING_MS;
+    ctx->mp3_s16_output = info->mp3_s16_output;
+    ctx->prepare_ms = info->prepare_ms ? info->prepare_ms : DEFAULT_PREPARE_MS;
+
+    // blocks are held only while mp3 frame straddles two input chunks, so few voices need one at once
+    hle_audio::rt::scratch_pool_create_info_t aux_pool_info = {};
+    aux_pool_info.allocator = ctx->allocator;
+    aux_pool_info.block_size = MP3_AUX_BLOCK_SIZE;
+    aux_pool_info.initial_block_count = MP3_AUX_INITIAL_BLOCK_COUNT;
+    ctx->mp3_aux_pool = hle_audio::rt::create_scratch_pool(aux_pool_info);
+
     return ctx.release();
 }
 
@@ -886,16 +1238,48 @@ void hlea_bind(hlea_context_t* ctx, editor_runtime_t* editor_rt) {
 #endif
 
 void hlea_destroy(hlea_context_t* ctx) {
+    // detach voices before their sources are gone
+    destroy(ctx->voice_pool);
+
     destroy(ctx->streaming_cache);
     destroy(ctx->async_io);
 
-    if (ctx->jobs.vt == &s_task_executor_jobs_vt) {
-        auto alloc_cb = make_allocation_callbacks(&ctx->allocator);
-        ma_device_job_thread_uninit(&ctx->task_executor, &alloc_cb);
-    }
+    // stop ticking before decoders are gone
+    auto node_alloc_cb = make_allocation_callbacks(&ctx->allocator);
+    ma_node_uninit(&ctx->decode_tick_node, &node_alloc_cb);
+    destroy(ctx->decode_scheduler);
 
-    for (size_t i = 0; i < ctx->output_bus_group_count; ++i) {
-        ma_sound_group_uninit(&ctx->output_bus_groups[i]);
+    for (uint16_t i = 0; i < ctx->decoders_mp3.size; ++i) {
+        destroy(ctx->decoders_mp3.vec[i]);
+    }
+    for (uint16_t i = 0; i < ctx->decoders_pcm.size; ++i) {
+        destroy(ctx->decoders_pcm.vec[i]);
+    }
+    for (uint16_t i = 0; i < ctx->decoders_vorbis.size; ++i) {
+        destroy(ctx->decoders_vorbis.vec[i]);
+    }
+    for (uint16_t i = 0; i < ctx->decoders_adpcm.size; ++i) {
+        destroy(ctx->decoders_adpcm.vec[i]);
+    }
+    for (uint16_t i = 0; i < ctx->decoders_flac.size; ++i) {
+        destroy(ctx->decoders_flac.vec[i]);
+    }
+    destroy(ctx->mp3_aux_pool);
+
+    if (ctx->pcm_cache) {
+        destroy(ctx->pcm_cache);
+    }
+
+    if (ctx->resident_data_cache) {
+        destroy(ctx->resident_data_cache);
+    }
+
+    if (ctx->thread_pool) {
+        destroy(ctx->thread_pool);
+    }
+
+    for (size_t i = 0; i < ctx->output_bus_group_count; ++i) {
+        ma_sound_group_uninit(&ctx->output_bus_groups[i]);
     }
     ma_engine_uninit(&ctx->engine);
 
@@ -911,17 +1295,117 @@ void hlea_wakeup(hlea_context_t* ctx) {
 }
 
 /**
- * init with allocated buffer
+ * init bank over the blob, data ownership is set up by caller
+ */
+static bool check_blob_version(const root_header_t* header) {
+    if (header->version == hle_audio::rt::STORE_BLOB_VERSION) return true;
+
+    printf("Bank blob version %u is not supported, expected %u. Rebuild the bank with the tool.\n",
+        header->version, hle_audio::rt::STORE_BLOB_VERSION);
+    return false;
+}
+
+template<typename T>
+static bool is_in_blob(const array_view_t<T>& arr, size_t blob_size) {
+    return uint64_t(arr.elements.pos) + uint64_t(arr.count) * sizeof(T) <= blob_size;
+}
+
+/**
+ * check program ops stay within program and reference existing data
+ */
+static bool validate_program(const buffer_t& buf, const array_view_t<program_op_t>& program, size_t blob_size, uint32_t file_count) {
+    if (!is_in_blob(program, blob_size)) return false;
+
+    for (uint32_t i = 0; i < program.count; ++i) {
+        auto& op = program.get(buf, i);
+        switch (op.type)
+        {
+        case program_op_e::play:
+        case program_op_e::play_loop:
+            if (file_count <= op.arg) return false;
+            break;
+        case program_op_e::random:
+            if (op.arg == 0 || program.count - i - 1 < op.arg) return false;
+            break;
+        case program_op_e::jump:
+            if (program.count < op.arg) return false;
+            break;
+        case program_op_e::loop_next:
+            if (program.count < op.arg || hle_audio::rt::MAX_PROGRAM_LOOP_DEPTH <= op.slot) return false;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * check blob header and store arrays are within the blob,
+ * resident sample data could be left out of blob and is checked against bank file size
+ */
+static bool validate_blob(const_data_buffer_t blob, uint64_t file_size) {
+    if (blob.size < sizeof(root_header_t)) return false;
+
+    auto header = (const root_header_t*)blob.data;
+    if (!check_blob_version(header)) return false;
+    if (header->stream_alignment & (header->stream_alignment - 1)) return false;
+    if (blob.size < header->store.pos + sizeof(hle_audio::rt::store_t)) return false;
+
+    buffer_t buf = {};
+    buf.ptr = const_cast<uint8_t*>(blob.data); // read only
+    auto store = header->store.get_ptr(buf);
+
+    bool valid = is_in_blob(store->groups, blob.size) &&
+        is_in_blob(store->events, blob.size) &&
+        is_in_blob(store->event_index, blob.size) &&
+        is_in_blob(store->file_data, blob.size);
+    if (!valid) return false;
+
+    for (uint32_t i = 0; i < store->file_data.count; ++i) {
+        auto& fd = store->file_data.get(buf, i);
+        if (!fd.meta.stream && !is_in_blob(fd.data_buffer, file_size)) return false;
+        if (!is_in_blob(fd.seek_table.frame_offsets, blob.size)) return false;
+        if (!is_in_blob(fd.stream_head, blob.size)) return false;
+    }
+
+    // power of 2 table with a free slot to end probing
+    auto& event_index = store->event_index;
+    if (store->events.count && 
+            (event_index.count <= store->events.count || (event_index.count & (event_index.count - 1)))) return false;
+    for (uint32_t i = 0; i < event_index.count; ++i) {
+        auto entry_event_index = event_index.get(buf, i).event_index;
+        if (entry_event_index != hle_audio::rt::EMPTY_EVENT_INDEX && store->events.count <= entry_event_index) return false;
+    }
+
+    for (uint32_t i = 0; i < store->groups.count; ++i) {
+        if (!validate_program(buf, store->groups.get(buf, i).program, blob.size, store->file_data.count)) return false;
+    }
+
+    return true;
+}
+
+/**
+ * @param file_size size of the whole bank file, resident sample data past data_size is read on demand
  */
-static hlea_event_bank_t* load_events_bank_buffer(hlea_context_t* ctx, void* pData) {
-    auto data_header = (root_header_t*)pData;
-    if (data_header->version != hle_audio::rt::STORE_BLOB_VERSION) {
-        deallocate(ctx->allocator, pData);
+static hlea_event_bank_t* load_events_bank_buffer(hlea_context_t* ctx, const void* pData, size_t data_size, uint64_t file_size) {
+    if (!pData || data_size < sizeof(root_header_t)) return nullptr;
+
+    // blob is accessed in place, so its types should be properly aligned
+    assert(is_aligned((const root_header_t*)pData));
+
+    auto data_header = (const root_header_t*)pData;
+
+    // program ops are run unchecked, so blob is validated on every load path
+    const_data_buffer_t blob = {};
+    blob.data = (const uint8_t*)pData;
+    blob.size = data_size;
+    if (!validate_blob(blob, file_size)) {
         return nullptr;
     }
 
     buffer_t buf = {};
-    buf.ptr = pData;
+    buf.ptr = const_cast<void*>(pData); // read only
 
     auto store = data_header->store.get_ptr(buf);
 
@@ -935,19 +1419,189 @@ static hlea_event_bank_t* load_events_bank_buffer(hlea_context_t* ctx, void* pDa
     return bank;
 }
 
-hlea_event_bank_t* hlea_load_events_bank(hlea_context_t* ctx, const char* bank_filename, const char* stream_bank_filename) {
-    data_buffer_t buffer = {};
-    ma_result result = read_file(ctx->pVFS, bank_filename, ctx->allocator, &buffer);
+static uint32_t get_stream_alignment(const hlea_event_bank_t* bank) {
+    return ((const root_header_t*)bank->data_buffer_ptr.ptr)->stream_alignment;
+}
+
+/**
+ * stream files are shared by name, so banks built with one stream file share cached chunks
+ */
+static stream_file_t* acquire_opened_stream_file(hlea_context_t* ctx, const char* filename) {
+    for (auto stream_file = ctx->stream_files; stream_file; stream_file = stream_file->next) {
+        if (strcmp(stream_file->filename, filename) == 0) {
+            ++stream_file->ref_count;
+            return stream_file;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * register opened file or mapping as streaming source, takes ownership of them
+ */
+static stream_file_t* add_stream_file(hlea_context_t* ctx, const char* filename, 
+        ma_vfs_file file, const hle_audio::rt::mapped_file_t& mapping, uint32_t alignment) {
+    auto stream_file = allocate<stream_file_t>(ctx->allocator);
+    *stream_file = {};
+    stream_file->ref_count = 1;
+    strcpy(stream_file->filename, filename);
+
+    if (mapping.data) {
+        stream_file->mapping = mapping;
+
+        hle_audio::rt::const_data_buffer_t mapped = {};
+        mapped.data = mapping.data;
+        mapped.size = mapping.size;
+        stream_file->cache_src = register_mapped_source(ctx->streaming_cache, mapped);
+    } else {
+        stream_file->file = file;
+        stream_file->afile = start_async_reading(ctx->async_io, file);
+        stream_file->cache_src = register_source(ctx->streaming_cache, stream_file->afile, alignment);
+    }
 
-    hlea_event_bank_t* res = load_events_bank_buffer(ctx, buffer.data);
+    stream_file->next = ctx->stream_files;
+    ctx->stream_files = stream_file;
+
+    return stream_file;
+}
 
-    result = ma_vfs_open(ctx->pVFS, stream_bank_filename, MA_OPEN_MODE_READ, &res->streaming_file);
+static void release_stream_file(hlea_context_t* ctx, stream_file_t* stream_file) {
+    assert(stream_file->ref_count);
+    if (--stream_file->ref_count) return;
+
+    // safe as all sounds of referencing banks're released and their decoders're stopped
+    deregister_source(ctx->streaming_cache, stream_file->cache_src);
+
+    // data shared by the banks
+    if (ctx->pcm_cache) {
+        invalidate(ctx->pcm_cache, stream_file);
+    }
+    if (ctx->resident_data_cache) {
+        invalidate(ctx->resident_data_cache, stream_file);
+    }
+    if (stream_file->afile) {
+        // wait for all reads to finish and stop
+        stop_async_reading(ctx->async_io, stream_file->afile);
+
+        // no more pending reads, close the file
+        ma_vfs_close(ctx->pVFS, stream_file->file);
+    } else {
+        // prefetches could still be touching the mapping
+        wait_all_requests(ctx->async_io);
+        unmap_file(&stream_file->mapping);
+    }
+
+    auto link = &ctx->stream_files;
+    while (*link != stream_file) link = &(*link)->next;
+    *link = stream_file->next;
+
+    deallocate(ctx->allocator, stream_file);
+}
+
+static void open_bank_streaming(hlea_context_t* ctx, hlea_event_bank_t* bank, const char* stream_bank_filename) {
+    if (MAX_BANK_PATH <= strlen(stream_bank_filename)) return;
+
+    bank->stream_file = acquire_opened_stream_file(ctx, stream_bank_filename);
+    if (bank->stream_file) return;
+
+    hle_audio::rt::mapped_file_t mapping = {};
+    if (ctx->use_mapped_streaming && map_file(stream_bank_filename, &mapping)) {
+        bank->stream_file = add_stream_file(ctx, stream_bank_filename, {}, mapping, 0);
+        return;
+    }
+
+    ma_vfs_file file = {};
+    ma_result result = ma_vfs_open(ctx->pVFS, stream_bank_filename, MA_OPEN_MODE_READ, &file);
     if (result == MA_SUCCESS) {
-        res->streaming_afile = start_async_reading(ctx->async_io, res->streaming_file);
-        res->streaming_cache_src = register_source(ctx->streaming_cache, res->streaming_afile);
+        bank->stream_file = add_stream_file(ctx, stream_bank_filename, file, {}, get_stream_alignment(bank));
     } else {
         // couldn't open file, do nothing here
     } 
+}
+
+/**
+ * size of blob part loaded with the bank, resident sample data tail is read on demand
+ */
+static ma_result get_blob_head_size(ma_vfs* vfs, ma_vfs_file file, size_t* out_size, uint64_t* out_file_size) {
+    ma_file_info info = {};
+    auto result = ma_vfs_info(vfs, file, &info);
+    if (result != MA_SUCCESS) return result;
+
+    root_header_t header = {};
+    size_t read_size = 0;
+    result = ma_vfs_read(vfs, file, &header, sizeof(header), &read_size);
+    if (result != MA_SUCCESS) return result;
+    if (read_size != sizeof(header)) return MA_INVALID_FILE;
+
+    // whole file for unexpected header, version is checked on load
+    uint64_t size = info.sizeInBytes;
+    if (sizeof(header) <= header.resident_data_offset && header.resident_data_offset < size) {
+        size = header.resident_data_offset;
+    }
+    if (MA_SIZE_MAX < size) return MA_TOO_BIG;
+
+    *out_size = size_t(size);
+    *out_file_size = info.sizeInBytes;
+    return MA_SUCCESS;
+}
+
+/**
+ * read blob without resident sample data, bank file stays open to read it on demand
+ */
+static hlea_event_bank_t* load_events_bank_lazy(hlea_context_t* ctx, const char* bank_filename) {
+    ma_vfs_file file = {};
+    if (ma_vfs_open(ctx->pVFS, bank_filename, MA_OPEN_MODE_READ, &file) != MA_SUCCESS) return nullptr;
+
+    data_buffer_t buffer = {};
+    uint64_t file_size = 0;
+    auto result = get_blob_head_size(ctx->pVFS, file, &buffer.size, &file_size);
+    if (result == MA_SUCCESS) {
+        result = ma_vfs_seek(ctx->pVFS, file, 0, ma_seek_origin_start);
+    }
+    if (result == MA_SUCCESS) {
+        buffer.data = (uint8_t*)allocate(ctx->allocator, buffer.size);
+        size_t read_size = 0;
+        result = buffer.data ? ma_vfs_read(ctx->pVFS, file, buffer.data, buffer.size, &read_size) : MA_OUT_OF_MEMORY;
+        if (result == MA_SUCCESS && read_size != buffer.size) result = MA_INVALID_FILE;
+    }
+
+    hlea_event_bank_t* res = nullptr;
+    if (result == MA_SUCCESS) {
+        res = load_events_bank_buffer(ctx, buffer.data, buffer.size, file_size);
+    }
+    if (!res) {
+        if (buffer.data) deallocate(ctx->allocator, buffer.data);
+        ma_vfs_close(ctx->pVFS, file);
+        return nullptr;
+    }
+    res->owns_data = true;
+    res->data_file = file;
+    res->data_afile = start_async_reading(ctx->async_io, file);
+
+    return res;
+}
+
+hlea_event_bank_t* hlea_load_events_bank(hlea_context_t* ctx, const char* bank_filename, const char* stream_bank_filename) {
+    if (ctx->resident_data_cache) {
+        auto res = load_events_bank_lazy(ctx, bank_filename);
+        if (res) {
+            open_bank_streaming(ctx, res, stream_bank_filename);
+        }
+        return res;
+    }
+
+    data_buffer_t buffer = {};
+    ma_result result = read_file(ctx->pVFS, bank_filename, ctx->allocator, &buffer);
+    if (result != MA_SUCCESS) return nullptr;
+
+    hlea_event_bank_t* res = load_events_bank_buffer(ctx, buffer.data, buffer.size, buffer.size);
+    if (!res) {
+        deallocate(ctx->allocator, buffer.data);
+        return nullptr;
+    }
+    res->owns_data = true;
+
+    open_bank_streaming(ctx, res, stream_bank_filename);
 
     return res;
 }
@@ -956,10 +1610,324 @@ hlea_event_bank_t* hlea_load_events_bank_from_buffer(hlea_context_t* ctx, const
     auto internal_buf = allocate(ctx->allocator, buf_size);
     memcpy(internal_buf, buf, buf_size);
 
-    return load_events_bank_buffer(ctx, internal_buf);
+    auto res = load_events_bank_buffer(ctx, internal_buf, buf_size, buf_size);
+    if (!res) {
+        deallocate(ctx->allocator, internal_buf);
+        return nullptr;
+    }
+    res->owns_data = true;
+
+    return res;
+}
+
+hlea_event_bank_t* hlea_load_events_bank_in_place(hlea_context_t* ctx, const void* data, size_t data_size) {
+    return load_events_bank_buffer(ctx, data, data_size, data_size);
+}
+
+hlea_event_bank_t* hlea_load_events_bank_mapped(hlea_context_t* ctx, const char* bank_filename, const char* stream_bank_filename) {
+    hle_audio::rt::mapped_file_t mapping = {};
+
+    // mapping goes around file api, use regular loading with custom one
+    bool default_file_api = ctx->pVFS == &ctx->vfs_default;
+    if (!default_file_api || !map_file(bank_filename, &mapping)) {
+        return hlea_load_events_bank(ctx, bank_filename, stream_bank_filename);
+    }
+
+    auto res = load_events_bank_buffer(ctx, mapping.data, mapping.size, mapping.size);
+    if (!res) {
+        unmap_file(&mapping);
+        return nullptr;
+    }
+    res->data_mapping = mapping;
+
+    open_bank_streaming(ctx, res, stream_bank_filename);
+
+    return res;
+}
+
+/**
+ * async loading
+ */
+struct bank_async_load_t {
+    ma_vfs* vfs;
+    bool map_streaming;
+    bool lazy_resident_data; // read blob without resident sample data, keep bank file for reading it
+
+    char bank_filename[MAX_BANK_PATH];
+    char stream_bank_filename[MAX_BANK_PATH];
+
+    // open job results
+    ma_result open_result;
+    ma_vfs_file bank_file;
+    uint64_t bank_file_size;
+    size_t blob_read_size;
+    ma_vfs_file stream_file;
+    hle_audio::rt::mapped_file_t stream_mapping;
+
+    // reading
+    async_file_handle_t bank_afile;
+    hle_audio::rt::async_read_token_t read_token;
+    data_buffer_t buffer;
+    size_t read_size;
+
+    // validate job result
+    bool valid;
+
+    std::atomic<bool> job_running;
+};
+
+static void open_bank_files_jobfunc(void* udata) {
+    auto load = (bank_async_load_t*)udata;
+
+    load->open_result = ma_vfs_open(load->vfs, load->bank_filename, MA_OPEN_MODE_READ, &load->bank_file);
+    if (load->open_result == MA_SUCCESS) {
+        ma_file_info info = {};
+        load->open_result = ma_vfs_info(load->vfs, load->bank_file, &info);
+        load->bank_file_size = info.sizeInBytes;
+        load->blob_read_size = (size_t)info.sizeInBytes;
+        if (load->open_result == MA_SUCCESS && MA_SIZE_MAX < info.sizeInBytes) {
+            load->open_result = MA_TOO_BIG;
+        }
+    }
+
+    if (load->open_result == MA_SUCCESS && load->lazy_resident_data) {
+        load->open_result = get_blob_head_size(load->vfs, load->bank_file, &load->blob_read_size, &load->bank_file_size);
+    }
+
+    if (load->open_result == MA_SUCCESS) {
+        if (!load->map_streaming || !map_file(load->stream_bank_filename, &load->stream_mapping)) {
+            // missing stream file is not an error, same as sync loading
+            if (ma_vfs_open(load->vfs, load->stream_bank_filename, MA_OPEN_MODE_READ, &load->stream_file) != MA_SUCCESS) {
+                load->stream_file = {};
+            }
+        }
+    }
+
+    load->job_running = false;
+}
+
+static void validate_bank_jobfunc(void* udata) {
+    auto load = (bank_async_load_t*)udata;
+
+    const_data_buffer_t blob = {};
+    blob.data = load->buffer.data;
+    blob.size = load->buffer.size;
+    load->valid = validate_blob(blob, load->bank_file_size);
+
+    load->job_running = false;
+}
+
+static void launch_load_job(hlea_context_t* ctx, bank_async_load_t* load, void (*job_func)(void* udata)) {
+    load->job_running = true;
+
+    hlea_job_t job = {};
+    job.job_func = job_func;
+    job.udata = load;
+    launch(ctx->jobs, job);
+}
+
+static void close_load_files(hlea_context_t* ctx, bank_async_load_t* load) {
+    if (load->bank_file) {
+        ma_vfs_close(ctx->pVFS, load->bank_file);
+        load->bank_file = {};
+    }
+    if (load->stream_file) {
+        ma_vfs_close(ctx->pVFS, load->stream_file);
+        load->stream_file = {};
+    }
+    unmap_file(&load->stream_mapping);
+}
+
+static void finish_async_load(hlea_context_t* ctx, hlea_event_bank_t* bank, bank_load_state_e state) {
+    auto load = bank->async_load;
+    assert(!load->job_running);
+
+    if (state == bank_load_state_e::ready) {
+        bank->data_buffer_ptr.ptr = load->buffer.data;
+        bank->owns_data = true;
+
+        // hand over bank file for resident data reading
+        if (load->bank_afile) {
+            bank->data_file = load->bank_file;
+            bank->data_afile = load->bank_afile;
+            load->bank_file = {};
+            load->bank_afile = {};
+        }
+
+        buffer_t buf = bank->data_buffer_ptr;
+        bank->static_data = ((const root_header_t*)load->buffer.data)->store.get_ptr(buf);
+
+        // hand over stream file to the bank, one opened by other bank is shared instead
+        bank->stream_file = acquire_opened_stream_file(ctx, load->stream_bank_filename);
+        if (!bank->stream_file && (load->stream_mapping.data || load->stream_file)) {
+            bank->stream_file = add_stream_file(ctx, load->stream_bank_filename, 
+                load->stream_file, load->stream_mapping, get_stream_alignment(bank));
+            load->stream_file = {};
+            load->stream_mapping = {};
+        }
+    } else {
+        deallocate(ctx->allocator, load->buffer.data);
+
+        // validation failed, no reads are left
+        if (load->bank_afile) {
+            release_async_file(ctx->async_io, load->bank_afile);
+            load->bank_afile = {};
+        }
+    }
+
+    close_load_files(ctx, load);
+
+    load->~bank_async_load_t();
+    deallocate(ctx->allocator, load);
+    bank->async_load = nullptr;
+    bank->load_state = state;
+}
+
+static void process_async_load(hlea_context_t* ctx, hlea_event_bank_t* bank) {
+    auto load = bank->async_load;
+    if (load->job_running) return;
+
+    switch (bank->load_state) {
+    case bank_load_state_e::opening: {
+        if (load->open_result != MA_SUCCESS) {
+            finish_async_load(ctx, bank, bank_load_state_e::failed);
+            break;
+        }
+
+        load->buffer.data = (uint8_t*)allocate(ctx->allocator, load->blob_read_size);
+        load->buffer.size = load->blob_read_size;
+        load->bank_afile = start_async_reading(ctx->async_io, load->bank_file);
+        if (!load->buffer.data || !load->bank_afile) {
+            if (load->bank_afile) release_async_file(ctx->async_io, load->bank_afile);
+            finish_async_load(ctx, bank, bank_load_state_e::failed);
+            break;
+        }
+
+        hle_audio::rt::async_read_request_t req = {};
+        req.file = load->bank_afile;
+        req.offset = 0;
+        req.out_buffer = load->buffer;
+        req.out_read_size = &load->read_size;
+        load->read_token = request_read(ctx->async_io, req);
+
+        bank->load_state = bank_load_state_e::reading;
+        break;
+    }
+    case bank_load_state_e::reading: {
+        if (check_request_running(ctx->async_io, load->read_token)) break;
+
+        // the only read of the file is done, unless resident data is read later
+        if (!load->lazy_resident_data) {
+            release_async_file(ctx->async_io, load->bank_afile);
+            load->bank_afile = {};
+        }
+
+        // file is shorter than reported or read failed
+        if (load->read_size != load->buffer.size) {
+            finish_async_load(ctx, bank, bank_load_state_e::failed);
+            break;
+        }
+
+        launch_load_job(ctx, load, validate_bank_jobfunc);
+        bank->load_state = bank_load_state_e::validating;
+        break;
+    }
+    case bank_load_state_e::validating: {
+        finish_async_load(ctx, bank, load->valid ? bank_load_state_e::ready : bank_load_state_e::failed);
+        break;
+    }
+    default:
+        assert(false && "unexpected loading state");
+        break;
+    }
+}
+
+static void process_loading_banks(hlea_context_t* ctx) {
+    for (uint8_t i = 0; i < ctx->loading_banks.size; ++i) {
+        auto bank = ctx->loading_banks.vec[i];
+        process_async_load(ctx, bank);
+
+        if (!bank->async_load) {
+            ctx->loading_banks.swap_remove(i);
+            --i;
+        }
+    }
+}
+
+hlea_event_bank_t* hlea_load_events_bank_async(hlea_context_t* ctx, const char* bank_filename, const char* stream_bank_filename) {
+    if (ctx->loading_banks.is_full()) return nullptr;
+    if (MAX_BANK_PATH <= strlen(bank_filename) || MAX_BANK_PATH <= strlen(stream_bank_filename)) return nullptr;
+
+    auto load = allocate<bank_async_load_t>(ctx->allocator);
+    new(load) bank_async_load_t();
+    load->vfs = ctx->pVFS;
+    load->map_streaming = ctx->use_mapped_streaming;
+    load->lazy_resident_data = ctx->resident_data_cache != nullptr;
+    strcpy(load->bank_filename, bank_filename);
+    strcpy(load->stream_bank_filename, stream_bank_filename);
+
+    auto bank = allocate<hlea_event_bank_t>(ctx->allocator);
+    *bank = {};
+    bank->load_state = bank_load_state_e::opening;
+    bank->async_load = load;
+
+    ctx->loading_banks.push_back(bank);
+
+    launch_load_job(ctx, load, open_bank_files_jobfunc);
+
+    return bank;
+}
+
+hlea_bank_state_e hlea_get_bank_state(hlea_context_t* /*ctx*/, const hlea_event_bank_t* bank) {
+    switch (bank->load_state) {
+    case bank_load_state_e::ready:
+        return hlea_bank_state_e::ready;
+    case bank_load_state_e::failed:
+        return hlea_bank_state_e::failed;
+    default:
+        break;
+    }
+    return hlea_bank_state_e::loading;
+}
+
+bool hlea_is_bank_ready(hlea_context_t* /*ctx*/, const hlea_event_bank_t* bank) {
+    return bank->load_state == bank_load_state_e::ready;
 }
 
+static void cancel_async_load(hlea_context_t* ctx, hlea_event_bank_t* bank) {
+    auto load = bank->async_load;
+
+    // jobs and reads can't be interrupted, wait for them
+    while (load->job_running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (bank->load_state == bank_load_state_e::reading) {
+        wait_all_requests(ctx->async_io);
+        release_async_file(ctx->async_io, load->bank_afile);
+        load->bank_afile = {};
+    }
+
+    finish_async_load(ctx, bank, bank_load_state_e::failed);
+
+    for (uint8_t i = 0; i < ctx->loading_banks.size; ++i) {
+        if (ctx->loading_banks.vec[i] == bank) {
+            ctx->loading_banks.swap_remove(i);
+            break;
+        }
+    }
+}
+
+static void flush_stopping_sounds(hlea_context_t* ctx);
+
 void hlea_unload_events_bank(hlea_context_t* ctx, hlea_event_bank_t* bank) {
+    if (bank->async_load) {
+        cancel_async_load(ctx, bank);
+    }
+    if (bank->load_state == bank_load_state_e::failed) {
+        deallocate(ctx->allocator, bank);
+        return;
+    }
+
     // stop all sounds from bank
     for (uint32_t active_index = 0u; active_index < ctx->active_groups_size; ++active_index) {
         group_data_t& group = ctx->active_groups[active_index];
@@ -970,23 +1938,40 @@ void hlea_unload_events_bank(hlea_context_t* ctx, hlea_event_bank_t* bank) {
         group_active_release(ctx, active_index);
         --active_index;
     }
+    for (uint8_t prepared_index = 0u; prepared_index < ctx->prepared_groups.size; ++prepared_index) {
+        if (ctx->prepared_groups.vec[prepared_index].bank != bank) continue;
 
-    if (bank->streaming_afile) {
-        // safe as all sounds're stopped feeding from the stream
-        deregister_source(ctx->streaming_cache, bank->streaming_cache_src);
-        bank->streaming_cache_src = {};
+        group_prepared_release(ctx, prepared_index);
+        --prepared_index;
+    }
+    flush_retiring_sounds(ctx);
+    flush_stopping_sounds(ctx);
 
-        // wait for all reads to finish and stop
-        stop_async_reading(ctx->async_io, bank->streaming_afile);
-        bank->streaming_afile = {};
+    if (ctx->pcm_cache) {
+        invalidate(ctx->pcm_cache, bank);
+    }
 
-        // no more pending reads, close the file
-        ma_vfs_close(ctx->pVFS, bank->streaming_file);
-        bank->streaming_file = {};
+    if (bank->data_afile) {
+        // waits for preloads still reading
+        invalidate(ctx->resident_data_cache, bank);
+
+        stop_async_reading(ctx->async_io, bank->data_afile);
+        bank->data_afile = {};
+        ma_vfs_close(ctx->pVFS, bank->data_file);
+        bank->data_file = {};
+    }
+
+    if (bank->stream_file) {
+        release_stream_file(ctx, bank->stream_file);
+        bank->stream_file = nullptr;
     }
 
-    // todo: push decoder could be using data_buffer_ptr (not yet the case), so need to keep buffer until 
-    deallocate(ctx->allocator, bank->data_buffer_ptr.ptr);
+    // decoders reading resident data and stream heads in place are stopped by now
+    if (bank->owns_data) {
+        deallocate(ctx->allocator, bank->data_buffer_ptr.ptr);
+    } else if (bank->data_mapping.data) {
+        unmap_file(&bank->data_mapping);
+    }
     deallocate(ctx->allocator, bank);
 }
 
@@ -1004,11 +1989,11 @@ void hlea_process_active_groups(hlea_context_t* ctx) {
             // apply fade out when it's time
             if (group.apply_sound_fade_out) {
                 ma_uint64 cursor, length;
-                ma_sound_get_cursor_in_pcm_frames(&sound_data_ptr->engine_sound, &cursor);
-                ma_sound_get_length_in_pcm_frames(&sound_data_ptr->engine_sound, &length);
+                ma_sound_get_cursor_in_pcm_frames(&sound_data_ptr->voice->sound, &cursor);
+                ma_sound_get_length_in_pcm_frames(&sound_data_ptr->voice->sound, &length);
 
                 ma_uint32 sample_rate;
-                ma_sound_get_data_format(&sound_data_ptr->engine_sound, NULL, NULL, &sample_rate, NULL, 0);
+                ma_sound_get_data_format(&sound_data_ptr->voice->sound, NULL, NULL, &sample_rate, NULL, 0);
 
                 auto engine_rate = ma_engine_get_sample_rate(&ctx->engine);
 
@@ -1020,7 +2005,7 @@ void hlea_process_active_groups(hlea_context_t* ctx) {
 
                 if (rest_frames_time <= group_data->cross_fade_time) {
                     group.apply_sound_fade_out = false;
-                    ma_sound_set_fade_in_pcm_frames(&sound_data_ptr->engine_sound, -1, 0, rest_frames_pcm);
+                    ma_sound_set_fade_in_pcm_frames(&sound_data_ptr->voice->sound, -1, 0, rest_frames_pcm);
                 }
             }
 
@@ -1029,7 +2014,7 @@ void hlea_process_active_groups(hlea_context_t* ctx) {
 
                 while(group.sound_id) {
                     auto sound_data_ptr = get_sound_data(ctx, group.sound_id);
-                    if (!ma_sound_is_playing(&sound_data_ptr->engine_sound)) {
+                    if (!ma_sound_is_playing(&sound_data_ptr->voice->sound)) {
                         uninit_and_release_sound(ctx, group.sound_id);
                         group.sound_id = group.next_sound_id;
                         group.next_sound_id = invalid_sound_id;
@@ -1037,7 +2022,7 @@ void hlea_process_active_groups(hlea_context_t* ctx) {
                 }
 
             // if playing 
-            } else if (ma_sound_at_end(&sound_data_ptr->engine_sound)) {
+            } else if (ma_sound_at_end(&sound_data_ptr->voice->sound)) {
                 uninit_and_release_sound(ctx, group.sound_id);
 
                 group.sound_id = group.next_sound_id;
@@ -1052,29 +2037,48 @@ void hlea_process_active_groups(hlea_context_t* ctx) {
     }
 }
 
-static void process_pending_sounds(hlea_context_t* ctx) {
-    for (size_t i = 0; i < ctx->pending_sounds_size; ++i) {
-        auto sound_id = ctx->pending_sounds[i];
+static void process_stopped_sounds(hlea_context_t* ctx) {
+    sound_id_t stopped_sounds[MAX_SOUNDS];
 
-        auto sound_data_ptr = get_sound_data(ctx, sound_id);
+    ma_spinlock_lock(&ctx->stopped_sounds_lock);
+    auto stopped_count = ctx->stopped_sounds_size;
+    std::copy_n(ctx->stopped_sounds, stopped_count, stopped_sounds);
+    ctx->stopped_sounds_size = 0;
+    ma_spinlock_unlock(&ctx->stopped_sounds_lock);
 
-        if (!is_running(sound_data_ptr->decoder)) {
-            //
-            // finish deinit of uninit_and_release_sound
-            //
-            release_sound_data(ctx, sound_id);
+    assert(stopped_count <= ctx->stopping_sounds_count);
+    ctx->stopping_sounds_count -= stopped_count;
 
-            // swap remove
-            ctx->pending_sounds[i] = ctx->pending_sounds[--ctx->pending_sounds_size];
-            --i;
+    //
+    // finish deinit of uninit_and_release_sound
+    //
+    for (uint16_t i = 0; i < stopped_count; ++i) {
+        release_sound_data(ctx, stopped_sounds[i]);
+    }
+}
+
+/**
+ * wait for decoders stopped on release to call back, jobs could be reading bank data till then,
+ * queued jobs are launched here while audio thread is stopped, so they get to stop
+ */
+static void flush_stopping_sounds(hlea_context_t* ctx) {
+    process_stopped_sounds(ctx);
+    while (ctx->stopping_sounds_count) {
+        if (!is_audio_thread_running(ctx)) {
+            process_period(ctx->decode_scheduler);
         }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        process_stopped_sounds(ctx);
     }
 }
 
 void hlea_process_frame(hlea_context_t* ctx) {
     update_pending_reads(ctx->streaming_cache);
+    process_loading_banks(ctx);
     hlea_process_active_groups(ctx);
-    process_pending_sounds(ctx);
+    process_prepared_groups(ctx);
+    process_retiring_sounds(ctx);
+    process_stopped_sounds(ctx);
 }
 
 static void fire_event(hlea_context_t* ctx, hlea_action_type_e event_type, const event_desc_t* desc) {
@@ -1119,23 +2123,39 @@ static void fire_event(hlea_context_t* ctx, hlea_action_type_e event_type, const
             group_resume_bus(ctx, desc);
             break;
         }
+        case hlea_action_type_e::prepare: {
+            group_prepare(ctx, desc);
+            break;
+        }
     }
 }
 
-void hlea_fire_event(hlea_context_t* ctx, hlea_event_bank_t* bank, const char* eventName, uint32_t obj_id) {
-    // find event with binary search
-    // todo: replace with hash index
+static const event_t* find_event(const hlea_event_bank_t* bank, const char* eventName) {
     auto buf_ptr = bank->data_buffer_ptr;
-    auto event_offset_begin = bank->static_data->events.elements.get_ptr(buf_ptr);
-    auto event_offset_end = event_offset_begin + bank->static_data->events.count;
-    auto event = std::lower_bound(event_offset_begin, event_offset_end,
-            eventName, [buf_ptr](const event_t& event, const char* str)
-            {
-                auto event_name = event.name.get_ptr(buf_ptr);
-                return strcmp(event_name, str) < 0;
-            });
-    if (event == event_offset_end) return;
+    auto& event_index = bank->static_data->event_index;
+    if (!event_index.count) return nullptr;
+
+    auto entries = event_index.elements.get_ptr(buf_ptr);
+    auto hash = hle_audio::rt::event_name_hash(eventName);
+    auto mask = event_index.count - 1;
+    for (auto slot = hash & mask; entries[slot].event_index != hle_audio::rt::EMPTY_EVENT_INDEX; slot = (slot + 1) & mask) {
+        if (entries[slot].name_hash != hash) continue;
+
+        // name is in cold part of blob, touched only on hash match
+        auto& event = bank->static_data->events.get(buf_ptr, entries[slot].event_index);
+        if (strcmp(event.name.get_ptr(buf_ptr), eventName) == 0) return &event;
+    }
+
+    return nullptr;
+}
 
+void hlea_fire_event(hlea_context_t* ctx, hlea_event_bank_t* bank, const char* eventName, uint32_t obj_id) {
+    if (bank->load_state != bank_load_state_e::ready) return;
+
+    auto event = find_event(bank, eventName);
+    if (!event) return;
+
+    auto buf_ptr = bank->data_buffer_ptr;
     auto actions_size = event->actions.count;
     auto actions = event->actions.elements.get_ptr(buf_ptr);
     for (uint32_t action_index = 0u; action_index < actions_size; ++action_index) {
@@ -1153,8 +2173,48 @@ void hlea_fire_event(hlea_context_t* ctx, hlea_event_bank_t* bank, const char* e
     }
 }
 
+void hlea_preload_group(hlea_context_t* ctx, hlea_event_bank_t* bank, uint32_t group_index) {
+    if (bank->load_state != bank_load_state_e::ready || !bank->data_afile) return;
+    if (bank->static_data->groups.count <= group_index) return;
+
+    auto buf_ptr = bank->data_buffer_ptr;
+    auto& program = bank_get_group(bank, group_index)->program;
+    auto ops = program.elements.get_ptr(buf_ptr);
+    for (uint32_t i = 0; i < program.count; ++i) {
+        if (ops[i].type != program_op_e::play) continue;
+
+        auto file_index = ops[i].arg;
+        if (!bank->static_data->file_data.get(buf_ptr, file_index).data_buffer.count) continue;
+
+        preload(ctx->resident_data_cache, make_resident_data_request(bank, file_index));
+    }
+}
+
+void hlea_prepare_event(hlea_context_t* ctx, hlea_event_bank_t* bank, const char* eventName, uint32_t obj_id) {
+    if (bank->load_state != bank_load_state_e::ready) return;
+
+    auto event = find_event(bank, eventName);
+    if (!event) return;
+
+    auto buf_ptr = bank->data_buffer_ptr;
+    auto actions_size = event->actions.count;
+    auto actions = event->actions.elements.get_ptr(buf_ptr);
+    for (uint32_t action_index = 0u; action_index < actions_size; ++action_index) {
+        auto action = &actions[action_index];
+        if (action->type != action_type_e::play && action->type != action_type_e::play_single) continue;
+
+        event_desc_t desc = {};
+        desc.bank = bank;
+        desc.target_index = action->target_index;
+        desc.obj_id = obj_id;
+
+        group_prepare(ctx, &desc);
+    }
+}
+
 void hlea_fire_event(hlea_context_t* ctx, const hlea_fire_event_info_t* event_info) {
     assert(event_info);
+    if (event_info->bank->load_state != bank_load_state_e::ready) return;
 
     for (uint32_t action_index = 0u; action_index< event_info->action_count; ++action_index) {
         auto& action = event_info->actions[action_index];
@@ -1181,6 +2241,43 @@ void hlea_set_bus_volume(hlea_context_t* ctx, uint8_t bus_index, float volume) {
  * editor api
  */
 
+void hlea_get_stats(hlea_context_t* ctx, hlea_stats_t* out_stats) {
+    hlea_stats_t res = {};
+
+    if (ctx->pcm_cache) {
+        auto cache_stats = get_stats(ctx->pcm_cache);
+        res.pcm_cache_hits = cache_stats.hits;
+        res.pcm_cache_misses = cache_stats.misses;
+        res.pcm_cache_entry_count = cache_stats.entry_count;
+        res.pcm_cache_used_bytes = cache_stats.used_bytes;
+    }
+
+    if (ctx->resident_data_cache) {
+        auto resident_stats = get_stats(ctx->resident_data_cache);
+        res.resident_data_hits = resident_stats.hits;
+        res.resident_data_misses = resident_stats.misses;
+        res.resident_data_entry_count = resident_stats.entry_count;
+        res.resident_data_used_bytes = resident_stats.used_bytes;
+    }
+
+    hle_audio::rt::mp3_decoder_create_info_t mp3_info = {};
+    mp3_info.output_ring_ms = ctx->mp3_output_ring_ms;
+    mp3_info.s16_output = ctx->mp3_s16_output;
+    res.mp3_decoder_count = ctx->decoders_mp3.size;
+    res.mp3_decoder_bytes = uint32_t(get_decoder_memory_size(mp3_info));
+    res.mp3_aux_pool_bytes = get_allocated_bytes(ctx->mp3_aux_pool);
+
+    auto voice_stats = get_stats(ctx->voice_pool);
+    res.voice_count = voice_stats.voice_count;
+    res.free_voice_count = voice_stats.free_count;
+    res.reused_voice_count = voice_stats.reused_count;
+
+    res.prepared_start_count = ctx->prepared_start_count;
+    res.cold_start_count = ctx->cold_start_count;
+
+    *out_stats = res;
+}
+
 size_t hlea_get_active_groups_count(hlea_context_t* ctx) {
     return ctx->active_groups_size;
 }
@@ -0,0 +1,101 @@
+#include "scratch_pool.h"
+
+#include "miniaudio_public.h" // ma_spinlock
+
+#include <cassert>
+
+#include "alloc_utils.inl"
+
+namespace hle_audio {
+namespace rt {
+
+struct free_block_t {
+    free_block_t* next;
+};
+
+struct scratch_pool_t {
+    allocator_t allocator;
+    size_t block_size;
+
+    ma_spinlock lock;
+    free_block_t* free_list;
+    // all blocks, linked through the block tail
+    uint8_t* allocated_list;
+    uint32_t allocated_count;
+};
+
+// every block keeps link to previously allocated one after its payload
+static uint8_t** block_link(const scratch_pool_t* pool, uint8_t* block) {
+    return (uint8_t**)(block + pool->block_size);
+}
+
+static uint8_t* allocate_block(scratch_pool_t* pool) {
+    auto block = (uint8_t*)allocate(pool->allocator, pool->block_size + sizeof(uint8_t*), alignof(std::max_align_t));
+    if (!block) return nullptr;
+
+    ma_spinlock_lock(&pool->lock);
+    *block_link(pool, block) = pool->allocated_list;
+    pool->allocated_list = block;
+    ++pool->allocated_count;
+    ma_spinlock_unlock(&pool->lock);
+
+    return block;
+}
+
+scratch_pool_t* create_scratch_pool(const scratch_pool_create_info_t& info) {
+    assert(sizeof(free_block_t) <= info.block_size);
+
+    auto pool = allocate<scratch_pool_t>(info.allocator);
+    *pool = {};
+    pool->allocator = info.allocator;
+    // keep link of the tail aligned
+    pool->block_size = (info.block_size + alignof(uint8_t*) - 1) & ~(alignof(uint8_t*) - 1);
+
+    for (uint32_t i = 0; i < info.initial_block_count; ++i) {
+        auto block = allocate_block(pool);
+        if (block) release_block(pool, block);
+    }
+
+    return pool;
+}
+
+void destroy(scratch_pool_t* pool) {
+    for (auto block = pool->allocated_list; block;) {
+        auto next = *block_link(pool, block);
+        deallocate(pool->allocator, block);
+        block = next;
+    }
+
+    deallocate(pool->allocator, pool);
+}
+
+uint8_t* acquire_block(scratch_pool_t* pool) {
+    ma_spinlock_lock(&pool->lock);
+    auto block = pool->free_list;
+    if (block) pool->free_list = block->next;
+    ma_spinlock_unlock(&pool->lock);
+
+    if (block) return (uint8_t*)block;
+
+    return allocate_block(pool);
+}
+
+void release_block(scratch_pool_t* pool, uint8_t* block) {
+    auto free_block = (free_block_t*)block;
+
+    ma_spinlock_lock(&pool->lock);
+    free_block->next = pool->free_list;
+    pool->free_list = free_block;
+    ma_spinlock_unlock(&pool->lock);
+}
+
+size_t get_block_size(const scratch_pool_t* pool) {
+    return pool->block_size;
+}
+
+size_t get_allocated_bytes(const scratch_pool_t* pool) {
+    return pool->allocated_count * (pool->block_size + sizeof(uint8_t*));
+}
+
+}
+}
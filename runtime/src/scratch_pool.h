@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "internal_alloc_types.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * thread-safe pool of fixed size blocks shared by decoders for short living data,
+ * grows on demand, blocks are freed on destroy only
+ */
+struct scratch_pool_t;
+
+struct scratch_pool_create_info_t {
+    allocator_t allocator;
+    size_t block_size;
+    uint32_t initial_block_count;
+};
+
+scratch_pool_t* create_scratch_pool(const scratch_pool_create_info_t& info);
+void destroy(scratch_pool_t* pool);
+
+/**
+ * @return nullptr if out of memory
+ */
+uint8_t* acquire_block(scratch_pool_t* pool);
+void release_block(scratch_pool_t* pool, uint8_t* block);
+
+size_t get_block_size(const scratch_pool_t* pool);
+size_t get_allocated_bytes(const scratch_pool_t* pool);
+
+}
+}
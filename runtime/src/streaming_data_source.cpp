@@ -1,13 +1,82 @@
 #include "streaming_data_source.h"
 
+#include <cstring>
+#include <algorithm>
+
+#include "alloc_utils.inl"
 #include "data_source_utils.inl"
 
 namespace hle_audio {
 namespace rt {
 
+// covers decoder restart from pinned chunk on loop wrap, few audio periods
+static const uint32_t LOOP_HEAD_MS = 250;
+
+static uint32_t get_frame_byte_size(const streaming_data_source_t* ds) {
+    return get_sample_byte_size(ds->format) * ds->channels;
+}
+
+static ma_uint64 get_loop_end(const file_data_t::meta_t& meta) {
+    return meta.loop_end ? meta.loop_end : meta.length_in_samples;
+}
+
+static void capture_loop_head(streaming_data_source_t* ds, const void* frames, ma_uint64 frame_count) {
+    auto capture_pos = ds->loop_start + ds->loop_head_filled;
+    if (capture_pos < ds->read_cursor || ds->read_cursor + frame_count <= capture_pos) return;
+
+    auto count = std::min(ds->read_cursor + frame_count - capture_pos, ds->loop_head_frames - ds->loop_head_filled);
+    if (!count) return;
+
+    auto frame_byte_size = get_frame_byte_size(ds);
+    memcpy(ds->loop_head + ds->loop_head_filled * frame_byte_size,
+        (const uint8_t*)frames + (capture_pos - ds->read_cursor) * frame_byte_size,
+        size_t(count * frame_byte_size));
+    ds->loop_head_filled += count;
+}
+
 static ma_result streaming_data_source_read(ma_data_source* pDataSource, void* pFramesOut, ma_uint64 frameCount, ma_uint64* pFramesRead) {
     streaming_data_source_t* ds = (streaming_data_source_t*)pDataSource;
 
+    // decoder could produce a bit more than meta length (e.g. mp3 padding)
+    frameCount = std::min(frameCount, ds->length_in_samples - ds->read_cursor);
+    if (frameCount == 0) return MA_SUCCESS;
+
+    auto frame_byte_size = get_frame_byte_size(ds);
+
+    // decoded ahead by prefetch, decoder continues right after it
+    if (ds->read_cursor < ds->preroll_filled) {
+        auto count = std::min(frameCount, ds->preroll_filled - ds->read_cursor);
+        memcpy(pFramesOut, ds->preroll + ds->read_cursor * frame_byte_size, size_t(count * frame_byte_size));
+
+        if (ds->loop_head) {
+            capture_loop_head(ds, pFramesOut, count);
+        }
+
+        ds->read_cursor += count;
+        *pFramesRead = count;
+
+        return MA_SUCCESS;
+    }
+
+    // wrapped into captured loop head
+    if (ds->reading_loop_head) {
+        auto head_pos = ds->read_cursor - ds->loop_start;
+        auto count = std::min(frameCount, ds->loop_head_frames - head_pos);
+
+        memcpy(pFramesOut, ds->loop_head + head_pos * frame_byte_size, size_t(count * frame_byte_size));
+
+        ds->read_cursor += count;
+        ds->reading_loop_head = ds->read_cursor < ds->loop_start + ds->loop_head_frames;
+        *pFramesRead = count;
+
+        // decoder restarted past the head on wrap, feed it so output is ready when the head ends
+        if (ds->loop_start + ds->loop_head_frames < get_loop_end(ds->meta)) {
+            pump(ds->decoder_reader);
+        }
+
+        return MA_SUCCESS;
+    }
+
     auto res = read_decoded(ds->decoder_reader, ds->channels, get_sample_byte_size(ds->format), pFramesOut, frameCount, pFramesRead);
     if (!res) {
         // todo: handle starvation?
@@ -15,17 +84,47 @@ static ma_result streaming_data_source_read(ma_data_source* pDataSource, void* p
         return MA_BUSY;
     }
 
+    if (ds->loop_head) {
+        capture_loop_head(ds, pFramesOut, *pFramesRead);
+    }
+
     ds->read_cursor += *pFramesRead;
 
     return MA_SUCCESS;
 }
 
+static void restart_decoding(streaming_data_source_t* ds, ma_uint64 frame_index) {
+    auto seek_input = find_seek_input(ds->meta, ds->seek_info, frame_index);
+    restart(ds->decoder_reader, seek_input.input_offset, seek_input.skip_frames * get_frame_byte_size(ds));
+}
+
 static ma_result streaming_data_source_seek(ma_data_source* pDataSource, ma_uint64 frameIndex) {
-    assert(false);
-    
-    // Seek to a specific PCM frame here. Return MA_NOT_IMPLEMENTED if seeking is not supported.
-    // ma_resource_manager_data_stream_seek_to_pcm_frame
-    return MA_NOT_IMPLEMENTED;
+    streaming_data_source_t* ds = (streaming_data_source_t*)pDataSource;
+
+    if (ds->length_in_samples < frameIndex) return MA_INVALID_ARGS;
+
+    ds->read_cursor = frameIndex;
+    ds->reading_loop_head = false;
+
+    // decoder is moved away from prefetched frames
+    ds->preroll_filled = 0;
+    ds->preroll_frames = 0;
+
+    // loop wrap, play captured head and decode what follows it
+    bool head_ready = ds->loop_head && ds->loop_head_filled == ds->loop_head_frames;
+    if (head_ready && frameIndex == ds->loop_start) {
+        ds->reading_loop_head = true;
+
+        auto head_end = ds->loop_start + ds->loop_head_frames;
+        if (head_end < get_loop_end(ds->meta)) {
+            restart_decoding(ds, head_end);
+        }
+        return MA_SUCCESS;
+    }
+
+    restart_decoding(ds, frameIndex);
+
+    return MA_SUCCESS;
 }
 
 static ma_result streaming_data_source_get_data_format(
@@ -88,12 +187,74 @@ ma_result streaming_data_source_init(streaming_data_source_t* data_source, const
     data_source->length_in_samples = info.meta.length_in_samples;
     data_source->channels = info.meta.channels;
     data_source->sample_rate = info.meta.sample_rate;
+    data_source->meta = info.meta;
+    data_source->seek_info = info.seek_info;
+    data_source->allocator = info.allocator;
+
+    if (info.loop) {
+        auto loop_end = get_loop_end(info.meta);
+        auto loop_start = std::min(info.meta.loop_start, loop_end);
+        auto head_ms = std::max(LOOP_HEAD_MS, info.min_loop_head_ms);
+        auto head_frames = std::min(ma_uint64(info.meta.sample_rate) * head_ms / 1000, loop_end - loop_start);
+
+        if (head_frames) {
+            data_source->loop_head = (uint8_t*)allocate(info.allocator, size_t(head_frames * get_frame_byte_size(data_source)));
+            data_source->loop_start = loop_start;
+            data_source->loop_head_frames = head_frames;
+
+            // decoding after the head starts from pinned chunk on wrap
+            auto head_end = loop_start + head_frames;
+            if (head_end < loop_end) {
+                auto seek_input = find_seek_input(info.meta, info.seek_info, head_end);
+                pin_chunk(data_source->decoder_reader, seek_input.input_offset);
+            }
+        }
+    }
 
     return MA_SUCCESS;
 }
 
+bool streaming_data_source_prefetch(streaming_data_source_t* ds, ma_uint64 frame_count) {
+    assert(ds->read_cursor == 0 && "source is already played");
+
+    if (!ds->preroll) {
+        frame_count = std::min(frame_count, ds->length_in_samples);
+        if (!frame_count) return true;
+
+        ds->preroll = (uint8_t*)allocate(ds->allocator, size_t(frame_count * get_frame_byte_size(ds)));
+        ds->preroll_frames = frame_count;
+    }
+
+    auto frame_byte_size = get_frame_byte_size(ds);
+    while (ds->preroll_filled < ds->preroll_frames) {
+        ma_uint64 frames_read = 0;
+        auto res = read_decoded(ds->decoder_reader, ds->channels, get_sample_byte_size(ds->format),
+            ds->preroll + ds->preroll_filled * frame_byte_size, ds->preroll_frames - ds->preroll_filled, &frames_read);
+        if (!res) return false;
+
+        // source is shorter than decoder reported
+        if (!frames_read) {
+            ds->preroll_frames = ds->preroll_filled;
+            break;
+        }
+        ds->preroll_filled += frames_read;
+    }
+
+    return true;
+}
+
 void streaming_data_source_uninit(streaming_data_source_t* data_source) {    
     deinit(data_source->decoder_reader);
+
+    if (data_source->loop_head) {
+        deallocate(data_source->allocator, data_source->loop_head);
+        data_source->loop_head = nullptr;
+    }
+
+    if (data_source->preroll) {
+        deallocate(data_source->allocator, data_source->preroll);
+        data_source->preroll = nullptr;
+    }
     
     // uninitialize the base data source.
     ma_data_source_uninit(&data_source->base);
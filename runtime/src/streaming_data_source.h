@@ -1,7 +1,9 @@
 #pragma once
 
 #include "miniaudio_public.h"
+#include "internal_alloc_types.h"
 #include "push_decoder_data_source.h"
+#include "frame_seek.h"
 
 namespace hle_audio {
 namespace rt {
@@ -15,20 +17,53 @@ struct streaming_data_source_t {
     ma_uint64 length_in_samples;
     ma_uint32 channels;
     ma_uint32 sample_rate;
+    file_data_t::meta_t meta;
+    frame_seek_info_t seek_info;
 
     ma_uint64 read_cursor;
+
+    allocator_t allocator;
+
+    // frames decoded by prefetch before the start, played ahead of decoder output
+    uint8_t* preroll;
+    ma_uint64 preroll_frames;
+    ma_uint64 preroll_filled;
+
+    /**
+     * decoded frames after loop start, captured on the first pass,
+     * wrap plays them while decoder restarts past the head
+     */
+    uint8_t* loop_head;
+    ma_uint64 loop_start;
+    ma_uint64 loop_head_frames;
+    ma_uint64 loop_head_filled;
+    bool reading_loop_head;
 };
 
 
 struct streaming_data_source_init_info_t {
     ma_format format;
     file_data_t::meta_t meta;
+    frame_seek_info_t seek_info;
 
     push_decoder_data_source_init_info_t decoder_reader_info;
+
+    // allocates prefetch preroll and loop head, when source is going to loop
+    allocator_t allocator;
+    bool loop;
+
+    // loop head covers at least decoder restart latency, 0 for default length
+    uint32_t min_loop_head_ms;
 };
 
 ma_result streaming_data_source_init(streaming_data_source_t* pDataSource, const streaming_data_source_init_info_t& info);
 void streaming_data_source_uninit(streaming_data_source_t* pDataSource);
 
+/**
+ * @brief decode first frames ahead of the start, called from the game thread until the source is played
+ * @return true when frame_count frames (or the whole source) are decoded, false if still waiting for data
+ */
+bool streaming_data_source_prefetch(streaming_data_source_t* pDataSource, ma_uint64 frame_count);
+
 }
 }
@@ -0,0 +1,241 @@
+#include "thread_pool.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "miniaudio_public.h" // ma_spinlock
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cassert>
+
+#include "alloc_utils.inl"
+
+namespace hle_audio {
+namespace rt {
+
+static const uint32_t MAX_WORKERS = 64;
+static const uint32_t WORKER_QUEUE_SIZE = 256;
+
+/**
+ * owner pushes and pops at the back, thieves take from the front
+ */
+struct worker_t {
+    ma_spinlock lock;
+    hlea_job_t jobs[WORKER_QUEUE_SIZE];
+    uint32_t front;
+    uint32_t back;
+
+    std::thread thread;
+};
+
+struct thread_pool_t {
+    allocator_t allocator;
+
+    worker_t* workers;
+    uint32_t worker_count;
+
+    // round robin worker for jobs launched from outside of the pool
+    std::atomic<uint32_t> next_worker;
+
+    std::atomic<uint32_t> queued_count;
+    std::atomic<uint32_t> sleeping_count;
+    std::mutex sleep_mutex;
+    std::condition_variable wake_signal;
+
+    std::atomic<bool> stopped;
+};
+
+static thread_local thread_pool_t* tls_pool;
+static thread_local uint32_t tls_worker_index;
+
+//---------------------------------------------------------------------------------------
+// worker deque
+
+static bool push_back(worker_t* worker, const hlea_job_t& job) {
+    ma_spinlock_lock(&worker->lock);
+    bool res = worker->back - worker->front < WORKER_QUEUE_SIZE;
+    if (res) {
+        worker->jobs[worker->back++ & (WORKER_QUEUE_SIZE - 1)] = job;
+    }
+    ma_spinlock_unlock(&worker->lock);
+
+    return res;
+}
+
+static bool pop_back(worker_t* worker, hlea_job_t* out_job) {
+    ma_spinlock_lock(&worker->lock);
+    bool res = worker->front != worker->back;
+    if (res) {
+        *out_job = worker->jobs[--worker->back & (WORKER_QUEUE_SIZE - 1)];
+    }
+    ma_spinlock_unlock(&worker->lock);
+
+    return res;
+}
+
+static bool steal_front(worker_t* worker, hlea_job_t* out_job) {
+    ma_spinlock_lock(&worker->lock);
+    bool res = worker->front != worker->back;
+    if (res) {
+        *out_job = worker->jobs[worker->front++ & (WORKER_QUEUE_SIZE - 1)];
+    }
+    ma_spinlock_unlock(&worker->lock);
+
+    return res;
+}
+
+//---------------------------------------------------------------------------------------
+// worker thread
+
+static bool take_job(thread_pool_t* pool, uint32_t worker_index, hlea_job_t* out_job) {
+    if (pop_back(&pool->workers[worker_index], out_job)) return true;
+
+    for (uint32_t i = 1; i < pool->worker_count; ++i) {
+        auto victim_index = (worker_index + i) % pool->worker_count;
+        if (steal_front(&pool->workers[victim_index], out_job)) return true;
+    }
+
+    return false;
+}
+
+static void worker_func(thread_pool_t* pool, uint32_t worker_index) {
+    tls_pool = pool;
+    tls_worker_index = worker_index;
+
+    while (!pool->stopped) {
+        hlea_job_t job = {};
+        if (take_job(pool, worker_index, &job)) {
+            pool->queued_count--;
+            job.job_func(job.udata);
+            continue;
+        }
+
+        // nothing to do, wait
+        pool->sleeping_count++;
+        {
+            std::unique_lock<std::mutex> lk(pool->sleep_mutex);
+            pool->wake_signal.wait(lk, [pool]() {
+                return pool->stopped || pool->queued_count;
+            });
+        }
+        pool->sleeping_count--;
+    }
+}
+
+static void pin_thread(std::thread& thread, uint32_t cpu) {
+#if defined(_WIN32)
+    SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    // todo: no hard affinity on this platform
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+//---------------------------------------------------------------------------------------
+// hlea_jobs_ti
+
+static void launch(thread_pool_t* pool, hlea_job_t job) {
+    bool queued = false;
+
+    // keep jobs launched by workers local, others spread round robin
+    uint32_t first_worker = (tls_pool == pool) ? tls_worker_index : pool->next_worker++ % pool->worker_count;
+    for (uint32_t i = 0; i < pool->worker_count && !queued; ++i) {
+        queued = push_back(&pool->workers[(first_worker + i) % pool->worker_count], job);
+    }
+
+    if (!queued) {
+        // all queues are full, don't lose the job
+        job.job_func(job.udata);
+        return;
+    }
+
+    pool->queued_count++;
+    if (pool->sleeping_count) {
+        // sync with sleeping worker predicate check
+        { std::lock_guard<std::mutex> lk(pool->sleep_mutex); }
+        pool->wake_signal.notify_one();
+    }
+}
+
+static void thread_pool_launch(void* udata, hlea_job_t job) {
+    launch((thread_pool_t*)udata, job);
+}
+
+static const hlea_jobs_ti s_thread_pool_jobs_vt {
+    thread_pool_launch
+};
+
+//---------------------------------------------------------------------------------------
+
+thread_pool_t* create_thread_pool(const thread_pool_create_info_t& info) {
+    uint32_t hw_count = std::thread::hardware_concurrency();
+
+    uint32_t worker_count = info.worker_count;
+    if (!worker_count) {
+        worker_count = 1 < hw_count ? hw_count - 1 : 1;
+    }
+    worker_count = worker_count < MAX_WORKERS ? worker_count : MAX_WORKERS;
+
+    auto pool = allocate<thread_pool_t>(info.allocator);
+    new(pool) thread_pool_t(); // init c++ stuff
+    pool->allocator = info.allocator;
+
+    pool->workers = (worker_t*)allocate(info.allocator, sizeof(worker_t) * worker_count, alignof(worker_t));
+    pool->worker_count = worker_count;
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        new(&pool->workers[i]) worker_t();
+    }
+
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        auto& worker = pool->workers[i];
+        worker.thread = std::thread(worker_func, pool, i);
+
+        if (info.pin_workers && hw_count) {
+            pin_thread(worker.thread, (i + 1) % hw_count);
+        }
+    }
+
+    return pool;
+}
+
+void destroy(thread_pool_t* pool) {
+    pool->stopped = true;
+    {
+        std::lock_guard<std::mutex> lk(pool->sleep_mutex);
+    }
+    pool->wake_signal.notify_all();
+
+    for (uint32_t i = 0; i < pool->worker_count; ++i) {
+        pool->workers[i].thread.join();
+        pool->workers[i].~worker_t();
+    }
+    deallocate(pool->allocator, pool->workers);
+
+    pool->~thread_pool_t();
+    deallocate(pool->allocator, pool);
+}
+
+jobs_t get_jobs(thread_pool_t* pool) {
+    jobs_t res = {};
+    res.vt = &s_thread_pool_jobs_vt;
+    res.udata = pool;
+    return res;
+}
+
+}
+}
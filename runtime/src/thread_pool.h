@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include "internal_alloc_types.h"
+#include "internal_jobs_types.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * work-stealing pool, default jobs implementation
+ */
+struct thread_pool_t;
+
+struct thread_pool_create_info_t {
+    allocator_t allocator;
+
+    // hardware concurrency - 1 if 0
+    uint8_t worker_count;
+
+    // pin worker i to cpu i + 1, cpu 0 is left for game and audio threads
+    bool pin_workers;
+};
+
+thread_pool_t* create_thread_pool(const thread_pool_create_info_t& info);
+
+/**
+ * stops workers, not started jobs are dropped
+ */
+void destroy(thread_pool_t* pool);
+
+jobs_t get_jobs(thread_pool_t* pool);
+
+}
+}
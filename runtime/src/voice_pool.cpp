@@ -0,0 +1,217 @@
+#include "voice_pool.h"
+
+#include <cstring>
+#include <cassert>
+
+#include "alloc_utils.inl"
+
+namespace hle_audio {
+namespace rt {
+
+struct voice_pool_t {
+    allocator_t allocator;
+    ma_engine* engine;
+    ma_sound_group* buses;
+    uint8_t bus_count;
+
+    // per bus
+    voice_t** free_lists;
+    voice_t* allocated_list;
+
+    uint32_t voice_count;
+    uint32_t free_count;
+    uint32_t reused_count;
+};
+
+/**
+ * silent source to init voices upfront, gives engine node format only
+ */
+struct placeholder_data_source_t {
+    ma_data_source_base base;
+    ma_uint32 channels;
+    ma_uint32 sample_rate;
+};
+
+static ma_result placeholder_read(ma_data_source* /*pDataSource*/, void* /*pFramesOut*/, ma_uint64 /*frameCount*/, ma_uint64* pFramesRead) {
+    *pFramesRead = 0;
+    return MA_AT_END;
+}
+
+static ma_result placeholder_seek(ma_data_source* /*pDataSource*/, ma_uint64 /*frameIndex*/) {
+    return MA_SUCCESS;
+}
+
+static ma_result placeholder_get_data_format(ma_data_source* pDataSource, ma_format* pFormat, ma_uint32* pChannels, ma_uint32* pSampleRate, ma_channel* pChannelMap, size_t channelMapCap) {
+    auto src = (placeholder_data_source_t*)pDataSource;
+
+    if (pFormat) *pFormat = ma_format_f32;
+    if (pChannels) *pChannels = src->channels;
+    if (pSampleRate) *pSampleRate = src->sample_rate;
+    if (pChannelMap) ma_channel_map_init_standard(ma_standard_channel_map_default, pChannelMap, channelMapCap, src->channels);
+
+    return MA_SUCCESS;
+}
+
+static ma_data_source_vtable g_placeholder_data_source_vtable = {
+    placeholder_read,
+    placeholder_seek,
+    placeholder_get_data_format,
+    nullptr, // onGetCursor
+    nullptr, // onGetLength
+    nullptr, // onSetLooping
+    0 // flags
+};
+
+static voice_t* init_voice(voice_pool_t* pool, uint8_t bus_index, ma_data_source* src) {
+    auto voice = allocate<voice_t>(pool->allocator);
+    *voice = {};
+
+    const ma_uint32 sound_flags = MA_SOUND_FLAG_NO_SPATIALIZATION;
+    ma_result result = ma_sound_init_from_data_source(pool->engine,
+        src,
+        sound_flags,
+        &pool->buses[bus_index],
+        &voice->sound);
+    if (result != MA_SUCCESS) {
+        deallocate(pool->allocator, voice);
+        return nullptr;
+    }
+
+    voice->bus_index = bus_index;
+    ma_data_source_get_data_format(src, nullptr, &voice->channels, nullptr, nullptr, 0);
+
+    voice->next_allocated = pool->allocated_list;
+    pool->allocated_list = voice;
+    ++pool->voice_count;
+
+    return voice;
+}
+
+static void push_free(voice_pool_t* pool, voice_t* voice) {
+    voice->next_free = pool->free_lists[voice->bus_index];
+    pool->free_lists[voice->bus_index] = voice;
+    ++pool->free_count;
+}
+
+voice_pool_t* create_voice_pool(const voice_pool_create_info_t& info) {
+    auto pool = allocate<voice_pool_t>(info.allocator);
+    *pool = {};
+    pool->allocator = info.allocator;
+    pool->engine = info.engine;
+    pool->buses = info.buses;
+    pool->bus_count = info.bus_count;
+
+    pool->free_lists = (voice_t**)allocate(info.allocator, info.bus_count * sizeof(voice_t*), alignof(voice_t*));
+    memset(pool->free_lists, 0, info.bus_count * sizeof(voice_t*));
+
+    // voices aren't started, so placeholder is never read
+    placeholder_data_source_t placeholder = {};
+    ma_data_source_config base_config = ma_data_source_config_init();
+    base_config.vtable = &g_placeholder_data_source_vtable;
+    ma_data_source_init(&base_config, &placeholder.base);
+    placeholder.channels = 2;
+    placeholder.sample_rate = ma_engine_get_sample_rate(info.engine);
+
+    for (uint8_t bus_index = 0; bus_index < info.bus_count; ++bus_index) {
+        for (uint16_t i = 0; i < info.prewarm_count; ++i) {
+            auto voice = init_voice(pool, bus_index, &placeholder);
+            if (!voice) break;
+
+            voice->sound.pDataSource = nullptr;
+            push_free(pool, voice);
+        }
+    }
+
+    ma_data_source_uninit(&placeholder.base);
+
+    return pool;
+}
+
+void destroy(voice_pool_t* pool) {
+    for (auto voice = pool->allocated_list; voice;) {
+        auto next = voice->next_allocated;
+        ma_sound_uninit(&voice->sound);
+        deallocate(pool->allocator, voice);
+        voice = next;
+    }
+
+    deallocate(pool->allocator, pool->free_lists);
+    deallocate(pool->allocator, pool);
+}
+
+/**
+ * reset what the previous play could change, audio thread doesn't process the voice
+ */
+static void rebind(voice_t* voice, ma_data_source* src) {
+    auto sound = &voice->sound;
+    auto& engine_node = sound->engineNode;
+
+    sound->pDataSource = src;
+    sound->seekTarget = ~(ma_uint64)0; // MA_SEEK_TARGET_NONE, defined in implementation part only
+    sound->atEnd = MA_FALSE;
+
+    // resampler ratio is updated by the audio thread once pitch differs from the old one
+    ma_uint32 sample_rate = 0;
+    ma_data_source_get_data_format(src, nullptr, nullptr, &sample_rate, nullptr, 0);
+    engine_node.sampleRate = sample_rate;
+    engine_node.oldPitch = -1.0f;
+
+    // drop interpolation history
+    // todo: resampler low-pass filter history is kept
+    auto& resampler = engine_node.resampler;
+    resampler.inTimeInt = 1;
+    resampler.inTimeFrac = 0;
+    memset(resampler.x0.f32, 0, resampler.config.channels * sizeof(float));
+    memset(resampler.x1.f32, 0, resampler.config.channels * sizeof(float));
+
+    ma_sound_set_pitch(sound, 1.0f);
+    ma_sound_set_volume(sound, 1.0f);
+    ma_sound_set_fade_in_pcm_frames(sound, 1.0f, 1.0f, 0);
+    ma_sound_set_start_time_in_pcm_frames(sound, 0);
+    ma_sound_set_stop_time_in_pcm_frames(sound, (ma_uint64)-1);
+    ma_node_set_time(sound, 0);
+}
+
+voice_t* acquire_voice(voice_pool_t* pool, uint8_t bus_index, ma_data_source* src) {
+    assert(bus_index < pool->bus_count);
+
+    ma_uint32 channels = 0;
+    if (ma_data_source_get_data_format(src, nullptr, &channels, nullptr, nullptr, 0) != MA_SUCCESS) return nullptr;
+
+    // find free voice with the same channels
+    auto link = &pool->free_lists[bus_index];
+    while (*link && (*link)->channels != channels) {
+        link = &(*link)->next_free;
+    }
+
+    if (auto voice = *link) {
+        *link = voice->next_free;
+        voice->next_free = nullptr;
+        --pool->free_count;
+        ++pool->reused_count;
+
+        rebind(voice, src);
+        return voice;
+    }
+
+    return init_voice(pool, bus_index, src);
+}
+
+void release_voice(voice_pool_t* pool, voice_t* voice) {
+    assert(!ma_sound_is_playing(&voice->sound));
+
+    // keep no reference to released data source
+    voice->sound.pDataSource = nullptr;
+    push_free(pool, voice);
+}
+
+voice_pool_stats_t get_stats(const voice_pool_t* pool) {
+    voice_pool_stats_t res = {};
+    res.voice_count = pool->voice_count;
+    res.free_count = pool->free_count;
+    res.reused_count = pool->reused_count;
+    return res;
+}
+
+}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include "internal_alloc_types.h"
+#include "miniaudio_public.h"
+
+namespace hle_audio {
+namespace rt {
+
+/**
+ * engine sounds kept initialized and attached to output buses,
+ * voice is rebound to a new data source on play instead of init/uninit in node graph,
+ * all functions are called from the game thread
+ */
+struct voice_pool_t;
+
+struct voice_t {
+    ma_sound sound;
+
+    uint8_t bus_index;
+    uint32_t channels; // engine node input channels are fixed on init
+
+    voice_t* next_free;
+    voice_t* next_allocated;
+};
+
+struct voice_pool_create_info_t {
+    allocator_t allocator;
+    ma_engine* engine;
+    ma_sound_group* buses;
+    uint8_t bus_count;
+
+    // stereo voices initialized upfront per bus
+    uint16_t prewarm_count;
+};
+
+struct voice_pool_stats_t {
+    uint32_t voice_count;
+    uint32_t free_count;
+    uint32_t reused_count;
+};
+
+voice_pool_t* create_voice_pool(const voice_pool_create_info_t& info);
+void destroy(voice_pool_t* pool);
+
+/**
+ * @brief rebind free voice with the same channels to data source, or init new one
+ * @return stopped voice with reset state, nullptr on failure
+ */
+voice_t* acquire_voice(voice_pool_t* pool, uint8_t bus_index, ma_data_source* src);
+
+/**
+ * voice should be stopped and already skipped by the audio thread
+ */
+void release_voice(voice_pool_t* pool, voice_t* voice);
+
+voice_pool_stats_t get_stats(const voice_pool_t* pool);
+
+}
+}
@@ -1,37 +1,120 @@
 #include "data_types.h"
 #include "file_data_provider.h"
 
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+
 using namespace hle_audio::editor;
 using namespace hle_audio::data;
 
-int main(int argc, char** argv) {
-    if (argc < 5) {
-        fprintf(stderr, "invalid params, expected format: <cmd> json_filename out_filename out_stream_filename sounds_path\n");
-        return 1;
-    }
-    const char* json_filename = argv[1];
-    const char* out_filename = argv[2];
-    const char* out_stream_filename = argv[3];
-    const char* sounds_path = argv[4];
+static void print_usage() {
+    fprintf(stderr, "invalid params, expected format:\n"
+        "  <cmd> json_filename out_filename out_stream_filename sounds_path [options]\n"
+        "  <cmd> --banks out_stream_filename sounds_path json_filename out_filename [json_filename out_filename ...] [options]\n"
+        "    banks share out_stream_filename, streamed data used by several banks is stored once\n"
+        "options: [--adpcm] [--stream-head-kb N] [--stream-align N]\n");
+}
 
+struct bank_paths_t {
+    const char* json_filename;
+    const char* out_filename;
+};
+
+static bool build_bank(const bank_paths_t& paths, file_data_provider_t* fd_prov,
+        stream_file_writer_t& stream_writer, uint32_t stream_head_size) {
     data_state_t state = {};
     init(state.node_ids);
 
-    if (!load_store_json(&state, json_filename)) {
-        fprintf(stderr, "Couldn't load data from json!\n");
+    if (!load_store_json(&state, paths.json_filename)) {
+        fprintf(stderr, "Couldn't load data from json %s!\n", paths.json_filename);
+        return false;
+    }
+
+    auto fb_buf = save_store_blob_buffer(&state, fd_prov, stream_writer, stream_head_size);
+    if (fb_buf.empty()) {
+        fprintf(stderr, "Couldn't build blob %s, repeat nodes are nested too deep!\n", paths.json_filename);
+        return false;
+    }
+
+    auto out_f = fopen(paths.out_filename, "wb");
+    if (out_f) {
+        fwrite(fb_buf.data(), 1, fb_buf.size(), out_f);
+        fclose(out_f);
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool multi_bank = 1 < argc && strcmp(argv[1], "--banks") == 0;
+
+    const char* out_stream_filename = nullptr;
+    const char* sounds_path = nullptr;
+    std::vector<bank_paths_t> banks;
+    int options_index = 0;
+    if (multi_bank) {
+        if (argc < 6) {
+            print_usage();
+            return 1;
+        }
+        out_stream_filename = argv[2];
+        sounds_path = argv[3];
+
+        // bank pairs till options
+        options_index = 4;
+        while (options_index + 1 < argc && strncmp(argv[options_index], "--", 2) != 0) {
+            banks.push_back({argv[options_index], argv[options_index + 1]});
+            options_index += 2;
+        }
+    } else {
+        if (argc < 5) {
+            print_usage();
+            return 1;
+        }
+        banks.push_back({argv[1], argv[2]});
+        out_stream_filename = argv[3];
+        sounds_path = argv[4];
+        options_index = 5;
+    }
+
+    bool use_adpcm = false;
+    uint32_t stream_head_size = 0;
+    uint32_t stream_alignment = 0;
+    for (int i = options_index; i < argc; ++i) {
+        if (strcmp(argv[i], "--adpcm") == 0) {
+            use_adpcm = true;
+        } else if (strcmp(argv[i], "--stream-head-kb") == 0 && i + 1 < argc) {
+            stream_head_size = uint32_t(atoi(argv[++i])) * 1024;
+        } else if (strcmp(argv[i], "--stream-align") == 0 && i + 1 < argc) {
+            stream_alignment = uint32_t(atoi(argv[++i]));
+        }
+    }
+
+    // power of 2 up to streaming chunk size
+    if ((stream_alignment & (stream_alignment - 1)) || 64 * 1024 < stream_alignment) {
+        fprintf(stderr, "invalid stream alignment, expected power of 2 up to 65536\n");
         return 1;
     }
 
     file_data_provider_t fd_prov = {};
     fd_prov.sounds_path = sounds_path;
     fd_prov.use_oggs = true;
-    auto fb_buf = save_store_blob_buffer(&state, &fd_prov, out_stream_filename);
+    fd_prov.use_adpcm = use_adpcm;
 
-    auto out_f = fopen(out_filename, "wb");
-    if (out_f) {
-        fwrite(fb_buf.data(), 1, fb_buf.size(), out_f);
-        fclose(out_f);
+    stream_file_writer_t stream_writer = {};
+    if (!open(stream_writer, out_stream_filename, stream_alignment)) {
+        fprintf(stderr, "Couldn't open stream file %s!\n", out_stream_filename);
+        return 1;
+    }
+
+    // data already written by previous banks is referenced by the next ones
+    bool built = true;
+    for (auto& bank : banks) {
+        built = build_bank(bank, &fd_prov, stream_writer, stream_head_size);
+        if (!built) break;
     }
+    close(stream_writer);
 
-    return 0;
-}
\ No newline at end of file
+    return built ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 #include <fstream>
 
 #include "miniaudio_public.h"
+#include "internal/ima_adpcm.inl"
 
 using hle_audio::editor::audio_file_data_t;
 using hle_audio::rt::const_data_buffer_t;
@@ -85,6 +86,138 @@ static bool find_wav_loop_point(const_data_buffer_t buffer_data, uint64_t* out_l
     return false;
 }
 
+/**
+ * checks WAVE fmt subchunk for 16 bit integer pcm samples
+ */
+static bool is_wav_pcm_s16(const_data_buffer_t buffer_data) {
+    const char fmt_tag_ansi[4] = {'f', 'm', 't', ' '};
+    auto fmt_range = find_wav_chunk(buffer_data, fmt_tag_ansi);
+    if (!fmt_range.data || fmt_range.size < 16) return false;
+
+    const uint16_t WAVE_FORMAT_PCM = 1;
+
+    uint16_t audio_format, bits_per_sample;
+    memcpy(&audio_format, fmt_range.data, sizeof(audio_format));
+    memcpy(&bits_per_sample, fmt_range.data + 14, sizeof(bits_per_sample));
+
+    return audio_format == WAVE_FORMAT_PCM && bits_per_sample == 16;
+}
+
+/**
+ * encodes interleaved s16 samples into planar IMA ADPCM blocks (see rt_types.h),
+ * last block is padded with silence
+ */
+static std::vector<uint8_t> encode_ima_adpcm(const_data_buffer_t pcm_data, uint8_t channels) {
+    using namespace hle_audio::rt;
+
+    const size_t frame_count = pcm_data.size / (sizeof(int16_t) * channels);
+    const size_t block_count = (frame_count + ADPCM_SAMPLES_PER_BLOCK - 1) / ADPCM_SAMPLES_PER_BLOCK;
+
+    std::vector<uint8_t> res(block_count * ADPCM_CHANNEL_BLOCK_BYTE_SIZE * channels);
+
+    // pcm data is copied as is, the tail is zero padded
+    const size_t block_sample_count = ADPCM_SAMPLES_PER_BLOCK * channels;
+    std::vector<int16_t> samples(block_count * block_sample_count);
+    memcpy(samples.data(), pcm_data.data, frame_count * channels * sizeof(int16_t));
+
+    std::vector<hle_audio::ima_adpcm_state_t> states(channels);
+    for (size_t block = 0; block < block_count; ++block) {
+        hle_audio::ima_encode_block(states.data(), samples.data() + block * block_sample_count,
+            channels, ADPCM_CHANNEL_BLOCK_BYTE_SIZE,
+            res.data() + block * channels * ADPCM_CHANNEL_BLOCK_BYTE_SIZE);
+    }
+
+    return res;
+}
+
+struct mp3_frame_header_t {
+    uint32_t frame_bytes;
+    uint32_t samples;
+};
+
+/**
+ * parses MPEG audio frame header, returns zero frame bytes if header is invalid
+ */
+static mp3_frame_header_t parse_mp3_frame_header(const uint8_t* h) {
+    static const uint16_t c_bitrates_kbps[2][3][15] = {
+        { // MPEG1: layer1, layer2, layer3
+            {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+            {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+        },
+        { // MPEG2, MPEG2.5
+            {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+            {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+        }
+    };
+    static const uint32_t c_sample_rates[3] = {44100, 48000, 32000};
+
+    if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0) return {};
+
+    uint32_t version_bits = (h[1] >> 3) & 3; // 0 - MPEG2.5, 2 - MPEG2, 3 - MPEG1
+    uint32_t layer_bits = (h[1] >> 1) & 3;   // 1 - layer3, 2 - layer2, 3 - layer1
+    uint32_t bitrate_index = h[2] >> 4;
+    uint32_t sample_rate_index = (h[2] >> 2) & 3;
+    uint32_t padding = (h[2] >> 1) & 1;
+
+    // reserved values and free format are not supported
+    if (version_bits == 1 || layer_bits == 0 || bitrate_index == 0 || bitrate_index == 15 || sample_rate_index == 3) return {};
+
+    bool mpeg1 = version_bits == 3;
+    uint32_t layer = 4 - layer_bits;
+    uint32_t bitrate = c_bitrates_kbps[mpeg1 ? 0 : 1][layer - 1][bitrate_index] * 1000;
+    uint32_t sample_rate = c_sample_rates[sample_rate_index] >> (mpeg1 ? 0 : (version_bits == 2 ? 1 : 2));
+
+    mp3_frame_header_t res = {};
+    if (layer == 1) {
+        res.samples = 384;
+        res.frame_bytes = (12 * bitrate / sample_rate + padding) * 4;
+    } else {
+        res.samples = (layer == 3 && !mpeg1) ? 576 : 1152;
+        res.frame_bytes = res.samples / 8 * bitrate / sample_rate + padding;
+    }
+    return res;
+}
+
+/**
+ * builds frames byte offsets table (every frames_per_entry-th frame), ID3v2 tag is skipped
+ */
+static std::vector<uint32_t> build_mp3_seek_table(const_data_buffer_t data, uint32_t frames_per_entry, uint32_t* out_samples_per_frame) {
+    size_t pos = 0;
+    if (10 <= data.size && memcmp(data.data, "ID3", 3) == 0) {
+        auto h = data.data;
+        uint32_t tag_size = (h[6] & 0x7f) << 21 | (h[7] & 0x7f) << 14 | (h[8] & 0x7f) << 7 | (h[9] & 0x7f);
+        bool has_footer = h[5] & 0x10;
+        pos = 10 + tag_size + (has_footer ? 10 : 0);
+    }
+
+    std::vector<uint32_t> res;
+    uint32_t frame_index = 0;
+    *out_samples_per_frame = 0;
+    while (pos + 4 <= data.size) {
+        auto header = parse_mp3_frame_header(data.data + pos);
+        if (!header.frame_bytes) {
+            // resync, skip garbage
+            ++pos;
+            continue;
+        }
+
+        // expect constant samples per frame
+        if (*out_samples_per_frame && *out_samples_per_frame != header.samples) return {};
+        *out_samples_per_frame = header.samples;
+
+        if (frame_index % frames_per_entry == 0) {
+            res.push_back(uint32_t(pos));
+        }
+
+        pos += header.frame_bytes;
+        ++frame_index;
+    }
+
+    return res;
+}
+
 namespace hle_audio {
 namespace data {
 
@@ -102,7 +235,7 @@ static std::vector<uint8_t> read_file(const fs::path& file_path) {
     return file_buf;
 }
 
-audio_file_data_t file_data_provider_t::get_file_data(const char* filename, uint32_t file_index) {
+audio_file_data_t file_data_provider_t::get_file_data(const char* filename, uint32_t /*file_index*/, bool stream) {
     fs::path full_path = fs::path(sounds_path) / filename;
     std::vector<uint8_t> file_buf = read_file(full_path);
     if (file_buf.size() == 0) return {};
@@ -122,6 +255,8 @@ audio_file_data_t file_data_provider_t::get_file_data(const char* filename, uint
         meta.coding_format = rt::audio_format_type_e::pcm;
     } else if (full_path.extension() == ".mp3") {
         meta.coding_format = rt::audio_format_type_e::mp3;
+    } else if (full_path.extension() == ".flac") {
+        meta.coding_format = rt::audio_format_type_e::flac;
     }
 
     audio_file_data_t res = {};
@@ -172,6 +307,32 @@ audio_file_data_t file_data_provider_t::get_file_data(const char* filename, uint
 
     ma_decoder_uninit(&decoder);
 
+    // streamed files keep their format, adpcm is for resident sounds
+    bool to_adpcm = use_adpcm && !stream &&
+        meta.coding_format == rt::audio_format_type_e::pcm && meta.channels <= IMA_MAX_CHANNELS &&
+        is_wav_pcm_s16(file_data_buf);
+    if (to_adpcm) {
+        const_data_buffer_t pcm_data = {};
+        pcm_data.data = res.content.data() + res.data_chunk_range.offset;
+        pcm_data.size = res.data_chunk_range.size;
+
+        res.content = encode_ima_adpcm(pcm_data, meta.channels);
+        res.data_chunk_range.offset = 0;
+        res.data_chunk_range.size = uint32_t(res.content.size());
+        meta.coding_format = rt::audio_format_type_e::adpcm;
+    }
+
+    if (meta.coding_format == rt::audio_format_type_e::mp3) {
+        const uint32_t MP3_FRAMES_PER_SEEK_ENTRY = 4;
+
+        const_data_buffer_t mp3_data = {};
+        mp3_data.data = res.content.data() + res.data_chunk_range.offset;
+        mp3_data.size = res.data_chunk_range.size;
+
+        res.seek_frame_offsets = build_mp3_seek_table(mp3_data, MP3_FRAMES_PER_SEEK_ENTRY, &res.samples_per_frame);
+        res.frames_per_seek_entry = MP3_FRAMES_PER_SEEK_ENTRY;
+    }
+
     res.meta = meta;
 
     assert(res.data_chunk_range.size);
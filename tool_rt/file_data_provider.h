@@ -9,8 +9,10 @@ class file_data_provider_t : public hle_audio::editor::audio_file_data_provider_
 public:
     const char* sounds_path;
     bool use_oggs = false;
+    // encode resident (not streamed) 16 bit wavs as IMA ADPCM
+    bool use_adpcm = false;
 
-    hle_audio::editor::audio_file_data_t get_file_data(const char* filename, uint32_t file_index) override;
+    hle_audio::editor::audio_file_data_t get_file_data(const char* filename, uint32_t file_index, bool stream) override;
 };
 
 }